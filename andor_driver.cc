@@ -0,0 +1,187 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 14:05:42 sb"
+
+/*
+  file       andor_driver.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "andor_driver.hh"
+#include "andor_simulator.hh"
+
+#include <wx/thread.h>
+#include <cstdio>
+
+
+#ifndef IMAGING_NO_ANDOR_SDK
+
+// Serializes SDK calls and remembers which camera they go to. The
+// SDK addresses all calls except the wait to the current camera of
+// the process, so selecting the camera and the call itself, downloads
+// included, have to happen under one lock.
+static wxMutex sdk_mutex;
+static at_32 sdk_current_handle = -1;
+
+// Hold the SDK lock with HANDLE as the current camera for the
+// lifetime of the object. If the camera cannot be made current,
+// GetError() tells why, and the call must not go to the SDK, which
+// would drive whichever camera was current before.
+class SdkLock {
+  private:
+    wxMutexLocker lock;
+    unsigned int rc;
+  public:
+    SdkLock(at_32 handle) : lock(sdk_mutex), rc(DRV_SUCCESS) {
+      if(handle != sdk_current_handle){
+        rc = ::SetCurrentCamera(handle);
+        sdk_current_handle = rc == DRV_SUCCESS ? handle : -1;
+      }
+    }
+    unsigned int GetError() const {return rc;}
+};
+
+// Body of a driver method: forward CALL to the SDK with the camera of
+// the driver selected, or fail if it cannot be.
+#define SDK_CALL(call) \
+  SdkLock l(handle); \
+  return l.GetError() != DRV_SUCCESS ? l.GetError() : ::call
+
+// Forward every call to the SDK for the camera at INDEX.
+class AndorHardwareDriver : public AndorDriver {
+  private:
+    int camera_index;
+    at_32 handle;
+    char name[32];
+
+  public:
+    AndorHardwareDriver(int camera_index_) : camera_index(camera_index_), handle(-1) {
+      sprintf(name,"Andor SDK camera %d",camera_index);
+    }
+
+    const char* GetName() const {return name;}
+
+    unsigned int Initialize(char* dir){
+      unsigned int rc = DRV_SUCCESS;
+      {
+        wxMutexLocker lock(sdk_mutex);
+        if((rc=::GetCameraHandle(camera_index,&handle)) != DRV_SUCCESS){
+          return rc;
+        }
+      }
+      SDK_CALL(Initialize(dir));
+    }
+    unsigned int ShutDown() {SDK_CALL(ShutDown());}
+    unsigned int FreeInternalMemory() {SDK_CALL(FreeInternalMemory());}
+    unsigned int GetVersionInfo(int id, char* buf, unsigned int size)
+      {SDK_CALL(GetVersionInfo((AT_VersionInfoId)id,buf,size));}
+
+    unsigned int GetDetector(int* xpixels, int* ypixels)
+      {SDK_CALL(GetDetector(xpixels,ypixels));}
+    unsigned int GetNumberADChannels(int* channels)
+      {SDK_CALL(GetNumberADChannels(channels));}
+    unsigned int GetNumberAmp(int* amp) {SDK_CALL(GetNumberAmp(amp));}
+    unsigned int GetNumberPreAmpGains(int* noGains)
+      {SDK_CALL(GetNumberPreAmpGains(noGains));}
+    unsigned int GetPreAmpGain(int index, float* gain)
+      {SDK_CALL(GetPreAmpGain(index,gain));}
+    unsigned int SetPreAmpGain(int index) {SDK_CALL(SetPreAmpGain(index));}
+    unsigned int GetBitDepth(int channel, int* depth)
+      {SDK_CALL(GetBitDepth(channel,depth));}
+    unsigned int GetNumberVSSpeeds(int* speeds)
+      {SDK_CALL(GetNumberVSSpeeds(speeds));}
+    unsigned int GetVSSpeed(int index, float* speed)
+      {SDK_CALL(GetVSSpeed(index,speed));}
+    unsigned int SetVSSpeed(int index) {SDK_CALL(SetVSSpeed(index));}
+    unsigned int GetNumberHSSpeeds(int channel, int typ, int* speeds)
+      {SDK_CALL(GetNumberHSSpeeds(channel,typ,speeds));}
+    unsigned int GetHSSpeed(int channel, int typ, int index, float* speed)
+      {SDK_CALL(GetHSSpeed(channel,typ,index,speed));}
+    unsigned int SetHSSpeed(int typ, int index)
+      {SDK_CALL(SetHSSpeed(typ,index));}
+    unsigned int SetADChannel(int channel) {SDK_CALL(SetADChannel(channel));}
+
+    unsigned int GetTemperatureRange(int* mintemp, int* maxtemp)
+      {SDK_CALL(GetTemperatureRange(mintemp,maxtemp));}
+    unsigned int SetTemperature(int temperature)
+      {SDK_CALL(SetTemperature(temperature));}
+    unsigned int GetTemperature(int* temperature)
+      {SDK_CALL(GetTemperature(temperature));}
+    unsigned int GetTemperatureF(float* temperature)
+      {SDK_CALL(GetTemperatureF(temperature));}
+    unsigned int IsCoolerOn(int* status) {SDK_CALL(IsCoolerOn(status));}
+    unsigned int CoolerON() {SDK_CALL(CoolerON());}
+    unsigned int CoolerOFF() {SDK_CALL(CoolerOFF());}
+
+    unsigned int SetAcquisitionMode(int mode)
+      {SDK_CALL(SetAcquisitionMode(mode));}
+    unsigned int SetReadMode(int mode) {SDK_CALL(SetReadMode(mode));}
+    unsigned int SetExposureTime(float time) {SDK_CALL(SetExposureTime(time));}
+    unsigned int SetFastKineticsEx(int exposedRows, int seriesLength, float time,
+                                   int mode, int hbin, int vbin, int offset)
+      {SDK_CALL(SetFastKineticsEx(exposedRows,seriesLength,time,mode,hbin,vbin,offset));}
+    unsigned int SetKineticCycleTime(float time)
+      {SDK_CALL(SetKineticCycleTime(time));}
+    unsigned int GetSizeOfCircularBuffer(at_32* index)
+      {SDK_CALL(GetSizeOfCircularBuffer(index));}
+    unsigned int GetAcquisitionTimings(float* exposure, float* accumulate, float* kinetic)
+      {SDK_CALL(GetAcquisitionTimings(exposure,accumulate,kinetic));}
+    unsigned int SetShutter(int typ, int mode, int closingtime, int openingtime)
+      {SDK_CALL(SetShutter(typ,mode,closingtime,openingtime));}
+    unsigned int SetTriggerMode(int mode) {SDK_CALL(SetTriggerMode(mode));}
+    unsigned int SetImage(int hbin, int vbin, int hstart, int hend, int vstart, int vend)
+      {SDK_CALL(SetImage(hbin,vbin,hstart,hend,vstart,vend));}
+
+    unsigned int StartAcquisition() {SDK_CALL(StartAcquisition());}
+    unsigned int AbortAcquisition() {SDK_CALL(AbortAcquisition());}
+    unsigned int GetStatus(int* status) {SDK_CALL(GetStatus(status));}
+    // Waits by handle without the lock, so the other cameras keep
+    // working meanwhile.
+    unsigned int WaitForAcquisitionTimeOut(int timeout_ms){
+      return ::WaitForAcquisitionByHandleTimeOut(handle,timeout_ms);
+    }
+    // Wakes up the waits of all cameras. The others see
+    // DRV_NO_NEW_DATA and simply wait again.
+    unsigned int CancelWait() {return ::CancelWait();}
+
+    unsigned int GetNumberAvailableImages(at_32* first, at_32* last)
+      {SDK_CALL(GetNumberAvailableImages(first,last));}
+    unsigned int GetImages16(at_32 first, at_32 last, WORD* arr, unsigned long size,
+                             at_32* validfirst, at_32* validlast)
+      {SDK_CALL(GetImages16(first,last,arr,size,validfirst,validlast));}
+};
+
+#undef SDK_CALL
+
+#endif // IMAGING_NO_ANDOR_SDK
+
+
+AndorDriver* create_andor_driver(bool simulate, int index){
+#ifndef IMAGING_NO_ANDOR_SDK
+  if(!simulate){
+    return new AndorHardwareDriver(index);
+  }
+#else
+  (void)simulate;
+#endif
+  return new AndorSimulator(index);
+}
+
+int andor_available_cameras(bool simulate){
+#ifndef IMAGING_NO_ANDOR_SDK
+  if(!simulate){
+    at_32 n = 0;
+    wxMutexLocker lock(sdk_mutex);
+    if(::GetAvailableCameras(&n) != DRV_SUCCESS){
+      return 0;
+    }
+    return (int)n;
+  }
+#else
+  (void)simulate;
+#endif
+  return 1;
+}
+
+
+// andor_driver.cc ends here
@@ -0,0 +1,137 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 14:02:11 sb"
+
+/*
+  file       andor_driver.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+  Interface to the Andor SDK functions used by the Camera class. The
+  hardware driver forwards every call to ATMCD32D.DLL, the simulated
+  driver in andor_simulator.hh emulates a camera in software, so that
+  the acquisition pipeline runs without hardware.
+
+  Method names, arguments and return codes follow the SDK. Define
+  IMAGING_NO_ANDOR_SDK to build without the SDK, which leaves only the
+  simulated driver.
+
+  Every driver instance talks to one camera, selected by its index
+  among the cameras the SDK finds. The SDK itself addresses a single
+  current camera per process, so the hardware driver selects its
+  camera under a process wide lock for every call. Only
+  WaitForAcquisitionTimeOut() waits outside the lock, by handle, so
+  that cameras acquire in parallel.
+
+ */
+
+
+#ifndef ANDOR_DRIVER_HH
+#define ANDOR_DRIVER_HH
+
+#ifndef IMAGING_NO_ANDOR_SDK
+#include <ATMCD32D.H>
+#else
+// Subset of ATMCD32D.H used by this program
+typedef long at_32;
+typedef unsigned short WORD;
+
+#define DRV_ERROR_ACK 20013
+#define DRV_ACQ_BUFFER 20018
+#define DRV_KINETIC_TIME_NOT_MET 20022
+#define DRV_ACCUM_TIME_NOT_MET 20023
+#define DRV_NO_NEW_DATA 20024
+#define DRV_SPOOLERROR 20026
+#define DRV_SUCCESS 20002
+#define DRV_TEMP_OFF 20034
+#define DRV_TEMP_NOT_STABILIZED 20035
+#define DRV_TEMP_STABILIZED 20036
+#define DRV_TEMP_NOT_REACHED 20037
+#define DRV_TEMP_DRIFT 20040
+#define DRV_P1INVALID 20066
+#define DRV_P2INVALID 20067
+#define DRV_P3INVALID 20068
+#define DRV_P4INVALID 20069
+#define DRV_ACQUIRING 20072
+#define DRV_IDLE 20073
+#define DRV_TEMPCYCLE 20074
+#define DRV_NOT_INITIALIZED 20075
+#define DRV_P5INVALID 20076
+#define DRV_P6INVALID 20077
+#define DRV_INVALID_MODE 20078
+#define DRV_NOT_SUPPORTED 20991
+
+#define AT_SDKVersion 0x40000000
+#define AT_DeviceDriverVersion 0x40000001
+#endif // IMAGING_NO_ANDOR_SDK
+
+
+class AndorDriver {
+  public:
+    virtual ~AndorDriver(){}
+
+    // Short description for the log
+    virtual const char* GetName() const = 0;
+
+    virtual unsigned int Initialize(char* dir) = 0;
+    virtual unsigned int ShutDown() = 0;
+    virtual unsigned int FreeInternalMemory() = 0;
+    virtual unsigned int GetVersionInfo(int id, char* buf, unsigned int size) = 0;
+
+    virtual unsigned int GetDetector(int* xpixels, int* ypixels) = 0;
+    virtual unsigned int GetNumberADChannels(int* channels) = 0;
+    virtual unsigned int GetNumberAmp(int* amp) = 0;
+    virtual unsigned int GetNumberPreAmpGains(int* noGains) = 0;
+    virtual unsigned int GetPreAmpGain(int index, float* gain) = 0;
+    virtual unsigned int SetPreAmpGain(int index) = 0;
+    virtual unsigned int GetBitDepth(int channel, int* depth) = 0;
+    virtual unsigned int GetNumberVSSpeeds(int* speeds) = 0;
+    virtual unsigned int GetVSSpeed(int index, float* speed) = 0;
+    virtual unsigned int SetVSSpeed(int index) = 0;
+    virtual unsigned int GetNumberHSSpeeds(int channel, int typ, int* speeds) = 0;
+    virtual unsigned int GetHSSpeed(int channel, int typ, int index, float* speed) = 0;
+    virtual unsigned int SetHSSpeed(int typ, int index) = 0;
+    virtual unsigned int SetADChannel(int channel) = 0;
+
+    virtual unsigned int GetTemperatureRange(int* mintemp, int* maxtemp) = 0;
+    virtual unsigned int SetTemperature(int temperature) = 0;
+    virtual unsigned int GetTemperature(int* temperature) = 0;
+    virtual unsigned int GetTemperatureF(float* temperature) = 0;
+    virtual unsigned int IsCoolerOn(int* status) = 0;
+    virtual unsigned int CoolerON() = 0;
+    virtual unsigned int CoolerOFF() = 0;
+
+    virtual unsigned int SetAcquisitionMode(int mode) = 0;
+    virtual unsigned int SetReadMode(int mode) = 0;
+    virtual unsigned int SetExposureTime(float time) = 0;
+    virtual unsigned int SetFastKineticsEx(int exposedRows, int seriesLength, float time,
+                                           int mode, int hbin, int vbin, int offset) = 0;
+    virtual unsigned int SetKineticCycleTime(float time) = 0;
+    virtual unsigned int GetSizeOfCircularBuffer(at_32* index) = 0;
+    virtual unsigned int GetAcquisitionTimings(float* exposure, float* accumulate,
+                                               float* kinetic) = 0;
+    virtual unsigned int SetShutter(int typ, int mode, int closingtime, int openingtime) = 0;
+    virtual unsigned int SetTriggerMode(int mode) = 0;
+    virtual unsigned int SetImage(int hbin, int vbin, int hstart, int hend,
+                                  int vstart, int vend) = 0;
+
+    virtual unsigned int StartAcquisition() = 0;
+    virtual unsigned int AbortAcquisition() = 0;
+    virtual unsigned int GetStatus(int* status) = 0;
+    virtual unsigned int WaitForAcquisitionTimeOut(int timeout_ms) = 0;
+    virtual unsigned int CancelWait() = 0;
+
+    virtual unsigned int GetNumberAvailableImages(at_32* first, at_32* last) = 0;
+    virtual unsigned int GetImages16(at_32 first, at_32 last, WORD* arr, unsigned long size,
+                                     at_32* validfirst, at_32* validlast) = 0;
+};
+
+// Create the hardware driver for camera INDEX, or a simulated one if
+// SIMULATE is set or the program was built without the SDK.
+AndorDriver* create_andor_driver(bool simulate, int index=0);
+
+// Number of cameras connected, 1 when simulating.
+int andor_available_cameras(bool simulate);
+
+
+#endif // ANDOR_DRIVER_HH
+
+// andor_driver.hh ends here
@@ -0,0 +1,747 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 15:12:40 sb"
+
+/*
+  file       andor_simulator.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "andor_simulator.hh"
+#include "monotonic_clock.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+static const float sim_vs_speeds[] = {4.25f, 8.25f, 16.25f}; // us per row
+static const float sim_hs_speeds[] = {5.0f, 3.0f, 1.0f, 0.05f}; // MHz
+static const float sim_preamp_gains[] = {1.0f, 2.0f, 4.0f};
+static const int sim_n_vs_speeds = sizeof(sim_vs_speeds)/sizeof(float);
+static const int sim_n_hs_speeds = sizeof(sim_hs_speeds)/sizeof(float);
+static const int sim_n_preamp_gains = sizeof(sim_preamp_gains)/sizeof(float);
+
+static const double sim_ambient_temperature = 20.0; // C
+static const double sim_cooling_time_constant = 20e3; // ms
+
+// Small xorshift generator for synthetic noise
+class SimRandom {
+  private:
+    unsigned long s;
+  public:
+    SimRandom(unsigned long seed) : s((seed & 0xffffffffUL) ? (seed & 0xffffffffUL) : 1) {}
+    double Uniform(){
+      s ^= (s << 13) & 0xffffffffUL;
+      s ^= s >> 17;
+      s ^= (s << 5) & 0xffffffffUL;
+      return (double)s / 4294967296.0;
+    }
+    // Approximately normal deviate (Irwin-Hall with four terms)
+    double Gauss(){
+      return (Uniform() + Uniform() + Uniform() + Uniform() - 2.0) * 1.7320508;
+    }
+};
+
+static unsigned long sim_hash(unsigned long a, unsigned long b, unsigned long c){
+  unsigned long h = 2166136261UL;
+  h = ((h ^ a) * 16777619UL) & 0xffffffffUL;
+  h = ((h ^ b) * 16777619UL) & 0xffffffffUL;
+  h = ((h ^ c) * 16777619UL) & 0xffffffffUL;
+  return h;
+}
+
+
+AndorSimulator::AndorSimulator(int camera_index_)
+  : condition(mutex),
+    camera_index(camera_index_),
+    initialized(false),
+    width(SIM_CCD_WIDTH),
+    height(SIM_CCD_HEIGHT),
+    vs_index(0),
+    hs_index(0),
+    preamp_index(0),
+    acquisition_mode(1),
+    trigger_mode(0),
+    exposure_time(0.01f),
+    kinetic_cycle_time(0),
+    image_hbin(1),
+    image_vbin(1),
+    image_hstart(1),
+    image_hend(SIM_CCD_WIDTH),
+    image_vstart(1),
+    image_vend(SIM_CCD_HEIGHT),
+    fk_rows(SIM_CCD_HEIGHT),
+    fk_series(1),
+    fk_hbin(1),
+    fk_vbin(1),
+    fk_offset(0),
+    fk_exposure_time(0.01f),
+    cooler_on(false),
+    target_temperature(20),
+    temperature_switch(sim_ambient_temperature),
+    t_switch(0),
+    acquiring(false),
+    started(false),
+    acquisition_id(0),
+    t_first(0),
+    t_step(1),
+    t_acquire(0),
+    t_stop(0),
+    images_signaled(0),
+    cancel_wait(false)
+{
+  sprintf(name,"simulated camera %d",camera_index);
+}
+
+AndorSimulator::~AndorSimulator(){
+}
+
+// ---------------------------------------------------------------- Model
+
+double AndorSimulator::vs_speed_us() const {
+  return sim_vs_speeds[vs_index];
+}
+
+double AndorSimulator::hs_speed_mhz() const {
+  return sim_hs_speeds[hs_index];
+}
+
+/*
+  Readout time of one image in ms. All rows up to the end of the
+  readout area shift through the register, rows outside the area are
+  dumped at the same speed. Only the binned pixels of the area get
+  digitized.
+ */
+double AndorSimulator::readout_ms() const {
+  double rows = acquisition_mode == 4 ? fk_offset + fk_rows : image_vend;
+  double px = (double)image_area() * series_length();
+  return 1e-3 * (rows*vs_speed_us() + px/hs_speed_mhz());
+}
+
+// Time from the start of the first exposure until the images are ready
+// for download, in ms.
+double AndorSimulator::acquisition_ms() const {
+  if(acquisition_mode == 4){
+    // exposures of the series plus shifting each image into storage
+    return fk_series * (1e3*fk_exposure_time + 1e-3*fk_rows*vs_speed_us())
+      + readout_ms();
+  }
+  return 1e3*exposure_time + readout_ms();
+}
+
+// Cooler relaxes exponentially towards the target, or back to ambient
+// temperature when off.
+double AndorSimulator::temperature(double t) const {
+  double target = cooler_on ? target_temperature : sim_ambient_temperature;
+  return target + (temperature_switch - target) * exp(-(t-t_switch)/sim_cooling_time_constant);
+}
+
+// End single scan and fast kinetics acquisitions whose images are
+// ready at time T.
+void AndorSimulator::update(double t){
+  if(acquiring && acquisition_mode != 5 && t >= t_first + t_acquire){
+    acquiring = false;
+    t_stop = t_first + t_acquire;
+  }
+}
+
+// Number of images of the current acquisition that are ready at time
+// T. Fast kinetics series count as one image.
+long AndorSimulator::completed_images(double t) const {
+  if(!started){
+    return 0;
+  }
+  if(!acquiring){
+    t = std::min(t,t_stop);
+  }
+  if(t < t_first + t_acquire){
+    return 0;
+  }
+  if(acquisition_mode != 5){
+    return 1;
+  }
+  return (long)floor((t - t_first - t_acquire) / t_step) + 1;
+}
+
+int AndorSimulator::series_length() const {
+  return acquisition_mode == 4 ? fk_series : 1;
+}
+
+int AndorSimulator::image_width() const {
+  return (image_hend - image_hstart + 1) / image_hbin;
+}
+
+int AndorSimulator::image_height() const {
+  if(acquisition_mode == 4){
+    return fk_rows / fk_vbin;
+  }
+  return (image_vend - image_vstart + 1) / image_vbin;
+}
+
+unsigned long AndorSimulator::image_area() const {
+  return (unsigned long)image_width() * image_height();
+}
+
+/*
+  Synthesize image INDEX of the series taken in acquisition
+  ACQUISITION as image number IMAGE into DATA. The cloud position and
+  atom number change from image to image, the noise also within a
+  series.
+ */
+void AndorSimulator::synthesize(long acquisition, long image, int index, WORD* data) const {
+  int w = image_width(), h = image_height();
+  int hb = acquisition_mode == 4 ? fk_hbin : image_hbin;
+  int vb = acquisition_mode == 4 ? fk_vbin : image_vbin;
+  int x0 = image_hstart - 1;
+  int y0 = acquisition_mode == 4 ? fk_offset : image_vstart - 1;
+
+  // 0 : dark, 1 : shadow, 2 : light
+  int kind = 1;
+  int n = series_length();
+  if(n == 2){
+    kind = index == 0 ? 1 : 2;
+  }
+  else if(n >= 3){
+    kind = index == 0 ? 0 : (index == 1 ? 1 : 2);
+  }
+
+  SimRandom shot(sim_hash(acquisition,image,0xfeed + camera_index));
+  double cx = 0.5*width + SIM_CLOUD_JITTER*shot.Gauss();
+  double cy = 0.5*height + SIM_CLOUD_JITTER*shot.Gauss();
+  double od = SIM_CLOUD_OD * (1.0 + 0.1*shot.Gauss());
+  // In fast kinetics, the cloud sits in the exposed rows.
+  if(acquisition_mode == 4){
+    cy = fk_offset + 0.5*fk_rows + SIM_CLOUD_JITTER*shot.Gauss();
+  }
+
+  std::vector<double> probe_x(w), probe_y(h), cloud_x(w), cloud_y(h);
+  double wz = SIM_PROBE_WAIST;
+  for(int i=0; i<w; ++i){
+    double x = x0 + (i+0.5)*hb;
+    probe_x[i] = exp(-2.0*(x-0.5*width)*(x-0.5*width)/(wz*wz));
+    cloud_x[i] = exp(-0.5*(x-cx)*(x-cx)/(SIM_CLOUD_SIGMA_X*SIM_CLOUD_SIGMA_X));
+  }
+  for(int j=0; j<h; ++j){
+    double y = y0 + (j+0.5)*vb;
+    probe_y[j] = exp(-2.0*(y-0.5*height)*(y-0.5*height)/(wz*wz));
+    cloud_y[j] = od*exp(-0.5*(y-cy)*(y-cy)/(SIM_CLOUD_SIGMA_Y*SIM_CLOUD_SIGMA_Y));
+  }
+
+  // Binning sums the charge of hb x vb pixels before digitization.
+  SimRandom noise(sim_hash(acquisition,image,(index+1) + 0x100*camera_index));
+  double counts = kind == 0 ? 0.0 : SIM_PROBE_COUNTS*hb*vb;
+  for(int j=0; j<h; ++j){
+    WORD* row = data + (size_t)j*w;
+    for(int i=0; i<w; ++i){
+      double s = counts*probe_x[i]*probe_y[j];
+      if(kind == 1){
+        s *= exp(-cloud_x[i]*cloud_y[j]);
+      }
+      double v = SIM_DARK_COUNTS + s + sqrt(s)*noise.Gauss() + SIM_READ_NOISE*noise.Gauss();
+      row[i] = (WORD)std::max(0.0,std::min(65535.0,floor(v+0.5)));
+    }
+  }
+}
+
+// ---------------------------------------------------------------- Setup
+
+unsigned int AndorSimulator::Initialize(char*){
+  wxMutexLocker lock(mutex);
+  initialized = true;
+  t_switch = monotonic_ms();
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::ShutDown(){
+  wxMutexLocker lock(mutex);
+  initialized = false;
+  acquiring = false;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::FreeInternalMemory(){
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetVersionInfo(int, char* buf, unsigned int size){
+  if(!buf || size == 0){
+    return DRV_P2INVALID;
+  }
+  strncpy(buf,"simulated",size-1);
+  buf[size-1] = 0;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetDetector(int* xpixels, int* ypixels){
+  if(!initialized){
+    return DRV_NOT_INITIALIZED;
+  }
+  *xpixels = width;
+  *ypixels = height;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetNumberADChannels(int* channels){
+  *channels = 1;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetNumberAmp(int* amp){
+  *amp = 1;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetNumberPreAmpGains(int* noGains){
+  *noGains = sim_n_preamp_gains;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetPreAmpGain(int index, float* gain){
+  if(index < 0 || index >= sim_n_preamp_gains){
+    return DRV_P1INVALID;
+  }
+  *gain = sim_preamp_gains[index];
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetPreAmpGain(int index){
+  if(index < 0 || index >= sim_n_preamp_gains){
+    return DRV_P1INVALID;
+  }
+  wxMutexLocker lock(mutex);
+  preamp_index = index;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetBitDepth(int channel, int* depth){
+  if(channel != 0){
+    return DRV_P1INVALID;
+  }
+  *depth = 16;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetNumberVSSpeeds(int* speeds){
+  *speeds = sim_n_vs_speeds;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetVSSpeed(int index, float* speed){
+  if(index < 0 || index >= sim_n_vs_speeds){
+    return DRV_P1INVALID;
+  }
+  *speed = sim_vs_speeds[index];
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetVSSpeed(int index){
+  if(index < 0 || index >= sim_n_vs_speeds){
+    return DRV_P1INVALID;
+  }
+  wxMutexLocker lock(mutex);
+  vs_index = index;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetNumberHSSpeeds(int channel, int typ, int* speeds){
+  if(channel != 0){
+    return DRV_P1INVALID;
+  }
+  if(typ != 0){
+    return DRV_P2INVALID;
+  }
+  *speeds = sim_n_hs_speeds;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetHSSpeed(int channel, int typ, int index, float* speed){
+  if(channel != 0){
+    return DRV_P1INVALID;
+  }
+  if(typ != 0){
+    return DRV_P2INVALID;
+  }
+  if(index < 0 || index >= sim_n_hs_speeds){
+    return DRV_P3INVALID;
+  }
+  *speed = sim_hs_speeds[index];
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetHSSpeed(int typ, int index){
+  if(typ != 0){
+    return DRV_P1INVALID;
+  }
+  if(index < 0 || index >= sim_n_hs_speeds){
+    return DRV_P2INVALID;
+  }
+  wxMutexLocker lock(mutex);
+  hs_index = index;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetADChannel(int channel){
+  return channel == 0 ? DRV_SUCCESS : DRV_P1INVALID;
+}
+
+// ---------------------------------------------------------------- Cooler
+
+unsigned int AndorSimulator::GetTemperatureRange(int* mintemp, int* maxtemp){
+  *mintemp = -120;
+  *maxtemp = 20;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetTemperature(int t){
+  if(t < -120 || t > 20){
+    return DRV_P1INVALID;
+  }
+  wxMutexLocker lock(mutex);
+  double now = monotonic_ms();
+  temperature_switch = temperature(now);
+  t_switch = now;
+  target_temperature = t;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetTemperature(int* t){
+  wxMutexLocker lock(mutex);
+  double x = temperature(monotonic_ms());
+  *t = (int)floor(x+0.5);
+  if(!cooler_on){
+    return DRV_TEMP_OFF;
+  }
+  return fabs(x - target_temperature) < 1.0 ? DRV_TEMP_STABILIZED : DRV_TEMP_NOT_REACHED;
+}
+
+unsigned int AndorSimulator::GetTemperatureF(float* t){
+  wxMutexLocker lock(mutex);
+  double x = temperature(monotonic_ms());
+  *t = (float)x;
+  if(!cooler_on){
+    return DRV_TEMP_OFF;
+  }
+  return fabs(x - target_temperature) < 1.0 ? DRV_TEMP_STABILIZED : DRV_TEMP_NOT_REACHED;
+}
+
+unsigned int AndorSimulator::IsCoolerOn(int* status){
+  wxMutexLocker lock(mutex);
+  *status = cooler_on ? 1 : 0;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::CoolerON(){
+  wxMutexLocker lock(mutex);
+  double now = monotonic_ms();
+  temperature_switch = temperature(now);
+  t_switch = now;
+  cooler_on = true;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::CoolerOFF(){
+  wxMutexLocker lock(mutex);
+  double now = monotonic_ms();
+  temperature_switch = temperature(now);
+  t_switch = now;
+  cooler_on = false;
+  return DRV_SUCCESS;
+}
+
+// ----------------------------------------------------------- Acquisition
+
+unsigned int AndorSimulator::SetAcquisitionMode(int mode){
+  if(mode != 1 && mode != 4 && mode != 5){
+    return DRV_P1INVALID;
+  }
+  wxMutexLocker lock(mutex);
+  if(acquiring){
+    return DRV_ACQUIRING;
+  }
+  acquisition_mode = mode;
+  started = false;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetReadMode(int mode){
+  return mode == 4 ? DRV_SUCCESS : DRV_P1INVALID;
+}
+
+unsigned int AndorSimulator::SetExposureTime(float time){
+  if(time < 0){
+    return DRV_P1INVALID;
+  }
+  wxMutexLocker lock(mutex);
+  exposure_time = time;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetFastKineticsEx(int exposedRows, int seriesLength, float time,
+                                               int mode, int hbin, int vbin, int offset)
+{
+  if(exposedRows < 1 || exposedRows > height){
+    return DRV_P1INVALID;
+  }
+  if(seriesLength < 1 || seriesLength*exposedRows > height){
+    return DRV_P2INVALID;
+  }
+  if(time < 0){
+    return DRV_P3INVALID;
+  }
+  if(mode != 4){
+    return DRV_P4INVALID;
+  }
+  if(hbin < 1 || hbin > width || vbin < 1 || exposedRows % vbin != 0){
+    return DRV_P5INVALID;
+  }
+  if(offset < (seriesLength-1)*exposedRows || offset + exposedRows > height){
+    return DRV_P5INVALID;
+  }
+  wxMutexLocker lock(mutex);
+  fk_rows = exposedRows;
+  fk_series = seriesLength;
+  fk_exposure_time = time;
+  fk_hbin = hbin;
+  fk_vbin = vbin;
+  fk_offset = offset;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetKineticCycleTime(float time){
+  if(time < 0){
+    return DRV_P1INVALID;
+  }
+  wxMutexLocker lock(mutex);
+  kinetic_cycle_time = time;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetSizeOfCircularBuffer(at_32* index){
+  *index = SIM_CIRCULAR_BUFFER;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetAcquisitionTimings(float* exposure, float* accumulate,
+                                                   float* kinetic)
+{
+  wxMutexLocker lock(mutex);
+  double t = acquisition_ms();
+  *exposure = acquisition_mode == 4 ? fk_exposure_time : exposure_time;
+  *accumulate = (float)(1e-3*t);
+  *kinetic = (float)std::max((double)kinetic_cycle_time,1e-3*t);
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetShutter(int typ, int mode, int, int){
+  if(typ != 0 && typ != 1){
+    return DRV_P1INVALID;
+  }
+  if(mode < 0 || mode > 2){
+    return DRV_P2INVALID;
+  }
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetTriggerMode(int mode){
+  if(mode != 0 && mode != 1){
+    return DRV_P1INVALID;
+  }
+  wxMutexLocker lock(mutex);
+  trigger_mode = mode;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::SetImage(int hbin, int vbin, int hstart, int hend,
+                                      int vstart, int vend)
+{
+  if(hbin < 1 || hbin > width){
+    return DRV_P1INVALID;
+  }
+  if(vbin < 1 || vbin > height){
+    return DRV_P2INVALID;
+  }
+  if(hstart < 1 || hstart > width){
+    return DRV_P3INVALID;
+  }
+  if(hend < hstart || hend > width || (hend-hstart+1) % hbin != 0){
+    return DRV_P4INVALID;
+  }
+  if(vstart < 1 || vstart > height){
+    return DRV_P5INVALID;
+  }
+  if(vend < vstart || vend > height || (vend-vstart+1) % vbin != 0){
+    return DRV_P6INVALID;
+  }
+  wxMutexLocker lock(mutex);
+  image_hbin = hbin;
+  image_vbin = vbin;
+  image_hstart = hstart;
+  image_hend = hend;
+  image_vstart = vstart;
+  image_vend = vend;
+  return DRV_SUCCESS;
+}
+
+/*
+  Set up the acquisition timeline. With internal trigger, the first
+  exposure starts right away and run till abort repeats as fast as the
+  kinetic cycle time and readout allow. With external trigger, every
+  image waits for the next trigger of the simulated experiment cycle.
+ */
+unsigned int AndorSimulator::StartAcquisition(){
+  wxMutexLocker lock(mutex);
+  if(!initialized){
+    return DRV_NOT_INITIALIZED;
+  }
+  double now = monotonic_ms();
+  update(now);
+  if(acquiring){
+    return DRV_ACQUIRING;
+  }
+  t_acquire = acquisition_ms();
+  double cycle = std::max(t_acquire,1e3*kinetic_cycle_time);
+  if(trigger_mode == 0){
+    t_first = now;
+    t_step = cycle;
+  }
+  else{
+    double p = SIM_TRIGGER_PERIOD_MS;
+    t_first = ceil(now/p)*p;
+    t_step = ceil(cycle/p)*p;
+  }
+  t_step = std::max(t_step,1e-3);
+  ++acquisition_id;
+  acquiring = true;
+  started = true;
+  images_signaled = 0;
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::AbortAcquisition(){
+  wxMutexLocker lock(mutex);
+  double now = monotonic_ms();
+  update(now);
+  if(!acquiring){
+    return DRV_IDLE;
+  }
+  acquiring = false;
+  t_stop = now;
+  condition.Broadcast();
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetStatus(int* status){
+  wxMutexLocker lock(mutex);
+  update(monotonic_ms());
+  *status = acquiring ? DRV_ACQUIRING : DRV_IDLE;
+  return DRV_SUCCESS;
+}
+
+/*
+  Return DRV_SUCCESS as soon as an image is ready that was not
+  reported before, DRV_NO_NEW_DATA on timeout or CancelWait(). Sleeps
+  on a condition until the next image is due, so waiting costs no CPU
+  time.
+ */
+unsigned int AndorSimulator::WaitForAcquisitionTimeOut(int timeout_ms){
+  wxMutexLocker lock(mutex);
+  double now = monotonic_ms();
+  double deadline = now + timeout_ms;
+  cancel_wait = false;
+  while(true){
+    update(now);
+    long n = completed_images(now);
+    if(n > images_signaled){
+      images_signaled = n;
+      return DRV_SUCCESS;
+    }
+    if(cancel_wait || now >= deadline){
+      cancel_wait = false;
+      return DRV_NO_NEW_DATA;
+    }
+    double wake = deadline;
+    if(acquiring){
+      wake = std::min(wake,t_first + t_acquire + images_signaled*t_step);
+    }
+    condition.WaitTimeout((unsigned long)std::max(1.0,ceil(wake-now)));
+    now = monotonic_ms();
+  }
+}
+
+unsigned int AndorSimulator::CancelWait(){
+  wxMutexLocker lock(mutex);
+  cancel_wait = true;
+  condition.Broadcast();
+  return DRV_SUCCESS;
+}
+
+// -------------------------------------------------------------- Download
+
+unsigned int AndorSimulator::GetNumberAvailableImages(at_32* first, at_32* last){
+  wxMutexLocker lock(mutex);
+  double now = monotonic_ms();
+  update(now);
+  long n = completed_images(now);
+  if(n == 0){
+    return DRV_NO_NEW_DATA;
+  }
+  if(acquisition_mode == 5){
+    *first = std::max(1L,n-SIM_CIRCULAR_BUFFER+1);
+    *last = n;
+  }
+  else{
+    *first = 1;
+    *last = series_length();
+  }
+  return DRV_SUCCESS;
+}
+
+unsigned int AndorSimulator::GetImages16(at_32 first, at_32 last, WORD* arr, unsigned long size,
+                                         at_32* validfirst, at_32* validlast)
+{
+  wxMutexLocker lock(mutex);
+  double now = monotonic_ms();
+  update(now);
+  long n = completed_images(now);
+  if(n == 0){
+    return DRV_NO_NEW_DATA;
+  }
+  if(acquisition_mode == 5){
+    // images from the circular buffer, as separate acquisitions
+    if(first < std::max(1L,n-SIM_CIRCULAR_BUFFER+1) || first > n){
+      return DRV_P1INVALID;
+    }
+    if(last < first || last > n){
+      return DRV_P2INVALID;
+    }
+  }
+  else{
+    if(first < 1 || first > series_length()){
+      return DRV_P1INVALID;
+    }
+    if(last < first || last > series_length()){
+      return DRV_P2INVALID;
+    }
+  }
+  unsigned long area = image_area();
+  if(size < (unsigned long)(last-first+1)*area){
+    return DRV_P4INVALID;
+  }
+  for(long k=first; k<=last; ++k){
+    if(acquisition_mode == 5){
+      synthesize(acquisition_id,k-1,0,arr + (k-first)*area);
+    }
+    else{
+      synthesize(acquisition_id,0,(int)(k-1),arr + (k-first)*area);
+    }
+  }
+  *validfirst = first;
+  *validlast = last;
+  return DRV_SUCCESS;
+}
+
+
+// andor_simulator.cc ends here
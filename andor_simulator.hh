@@ -0,0 +1,165 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 14:31:26 sb"
+
+/*
+  file       andor_simulator.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef ANDOR_SIMULATOR_HH
+#define ANDOR_SIMULATOR_HH
+
+#include <wx/thread.h>
+
+#include "andor_driver.hh"
+
+// Simulated CCD geometry in px
+#define SIM_CCD_WIDTH 1024
+#define SIM_CCD_HEIGHT 1024
+
+// Period of the simulated experiment cycle that provides external
+// triggers, in ms
+#define SIM_TRIGGER_PERIOD_MS 100.0
+
+// Number of images the simulated circular buffer holds in run till
+// abort mode
+#define SIM_CIRCULAR_BUFFER 32
+
+// Synthetic absorption images, in counts per unbinned pixel and px
+#define SIM_DARK_COUNTS 300.0
+#define SIM_READ_NOISE 8.0
+#define SIM_PROBE_COUNTS 3000.0
+#define SIM_PROBE_WAIST 500.0
+#define SIM_CLOUD_OD 1.2
+#define SIM_CLOUD_SIGMA_X 40.0
+#define SIM_CLOUD_SIGMA_Y 30.0
+#define SIM_CLOUD_JITTER 5.0
+
+/*
+  Software model of an Andor CCD camera. It implements the acquisition
+  modes used by the program (single scan, fast kinetics and run till
+  abort), internal and external triggers, and exposure and readout
+  timing derived from the shift and digitization speeds. Acquisitions
+  are not simulated in a thread of their own. Instead, every call
+  compares the current time with the acquisition timeline set up by
+  StartAcquisition(), so the status always reflects when a real camera
+  would be done. Images are synthesized on download: a Gaussian probe
+  beam with a Gaussian atom cloud in absorption, plus dark counts, shot
+  noise and read noise. In fast kinetics mode with three images, the
+  series is dark, shadow, light as expected by ImageFrame.
+ */
+class AndorSimulator : public AndorDriver {
+  private:
+    wxMutex mutex; // protects everything below
+    wxCondition condition; // signaled by CancelWait()
+
+    int camera_index; // varies the synthetic images between cameras
+    char name[32];
+    bool initialized;
+    int width; // chip width in px
+    int height; // chip height in px
+    int vs_index; // vertical shift speed
+    int hs_index; // horizontal readout speed
+    int preamp_index;
+
+    int acquisition_mode;
+    int trigger_mode;
+    float exposure_time; // s
+    float kinetic_cycle_time; // s, run till abort
+    int image_hbin, image_vbin, image_hstart, image_hend, image_vstart, image_vend;
+    int fk_rows, fk_series, fk_hbin, fk_vbin, fk_offset;
+    float fk_exposure_time; // s
+
+    bool cooler_on;
+    int target_temperature;
+    double temperature_switch; // temperature when the cooler was switched
+    double t_switch; // time of the last cooler switch in ms
+
+    bool acquiring;
+    bool started; // acquisition started since the last setup change
+    long acquisition_id; // counts StartAcquisition() calls
+    double t_first; // start of first exposure in ms
+    double t_step; // time between consecutive images in ms
+    double t_acquire; // time from exposure start to image ready in ms
+    double t_stop; // time the acquisition stopped in ms
+    long images_signaled; // images reported by WaitForAcquisitionTimeOut()
+    bool cancel_wait;
+
+    AndorSimulator(const AndorSimulator&) : condition(mutex) {}
+
+    double vs_speed_us() const;
+    double hs_speed_mhz() const;
+    double readout_ms() const;
+    double acquisition_ms() const;
+    double temperature(double t) const;
+    void update(double t);
+    long completed_images(double t) const;
+    int series_length() const;
+    int image_width() const;
+    int image_height() const;
+    unsigned long image_area() const;
+    void synthesize(long acquisition, long image, int index, WORD* data) const;
+
+  public:
+    AndorSimulator(int camera_index_=0);
+    ~AndorSimulator();
+
+    const char* GetName() const {return name;}
+
+    unsigned int Initialize(char* dir);
+    unsigned int ShutDown();
+    unsigned int FreeInternalMemory();
+    unsigned int GetVersionInfo(int id, char* buf, unsigned int size);
+
+    unsigned int GetDetector(int* xpixels, int* ypixels);
+    unsigned int GetNumberADChannels(int* channels);
+    unsigned int GetNumberAmp(int* amp);
+    unsigned int GetNumberPreAmpGains(int* noGains);
+    unsigned int GetPreAmpGain(int index, float* gain);
+    unsigned int SetPreAmpGain(int index);
+    unsigned int GetBitDepth(int channel, int* depth);
+    unsigned int GetNumberVSSpeeds(int* speeds);
+    unsigned int GetVSSpeed(int index, float* speed);
+    unsigned int SetVSSpeed(int index);
+    unsigned int GetNumberHSSpeeds(int channel, int typ, int* speeds);
+    unsigned int GetHSSpeed(int channel, int typ, int index, float* speed);
+    unsigned int SetHSSpeed(int typ, int index);
+    unsigned int SetADChannel(int channel);
+
+    unsigned int GetTemperatureRange(int* mintemp, int* maxtemp);
+    unsigned int SetTemperature(int temperature);
+    unsigned int GetTemperature(int* temperature);
+    unsigned int GetTemperatureF(float* temperature);
+    unsigned int IsCoolerOn(int* status);
+    unsigned int CoolerON();
+    unsigned int CoolerOFF();
+
+    unsigned int SetAcquisitionMode(int mode);
+    unsigned int SetReadMode(int mode);
+    unsigned int SetExposureTime(float time);
+    unsigned int SetFastKineticsEx(int exposedRows, int seriesLength, float time,
+                                   int mode, int hbin, int vbin, int offset);
+    unsigned int SetKineticCycleTime(float time);
+    unsigned int GetSizeOfCircularBuffer(at_32* index);
+    unsigned int GetAcquisitionTimings(float* exposure, float* accumulate, float* kinetic);
+    unsigned int SetShutter(int typ, int mode, int closingtime, int openingtime);
+    unsigned int SetTriggerMode(int mode);
+    unsigned int SetImage(int hbin, int vbin, int hstart, int hend, int vstart, int vend);
+
+    unsigned int StartAcquisition();
+    unsigned int AbortAcquisition();
+    unsigned int GetStatus(int* status);
+    unsigned int WaitForAcquisitionTimeOut(int timeout_ms);
+    unsigned int CancelWait();
+
+    unsigned int GetNumberAvailableImages(at_32* first, at_32* last);
+    unsigned int GetImages16(at_32 first, at_32 last, WORD* arr, unsigned long size,
+                             at_32* validfirst, at_32* validlast);
+};
+
+
+#endif // ANDOR_SIMULATOR_HH
+
+// andor_simulator.hh ends here
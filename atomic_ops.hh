@@ -0,0 +1,67 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 10:12:41 sb"
+
+/*
+  file       atomic_ops.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+  Minimal set of atomic integer operations for lock-free hand-off
+  between threads. All operations are full memory barriers. Uses the
+  Interlocked intrinsics on MSVC and the __sync builtins on gcc.
+
+ */
+
+
+#ifndef ATOMIC_OPS_HH
+#define ATOMIC_OPS_HH
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_InterlockedCompareExchange)
+#pragma intrinsic(_InterlockedExchange)
+#pragma intrinsic(_InterlockedExchangeAdd)
+#endif
+
+typedef volatile long atomic_long_t;
+
+// Read *P with full barrier semantics.
+inline long atomic_get(atomic_long_t* p){
+#ifdef _MSC_VER
+  return _InterlockedCompareExchange(p,0,0);
+#else
+  return __sync_val_compare_and_swap(p,0,0);
+#endif
+}
+
+// Set *P to V and return the previous value.
+inline long atomic_set(atomic_long_t* p, long v){
+#ifdef _MSC_VER
+  return _InterlockedExchange(p,v);
+#else
+  __sync_synchronize();
+  return __sync_lock_test_and_set(p,v);
+#endif
+}
+
+// Set *P to DESIRED if it equals EXPECTED. Return true on success.
+inline bool atomic_cas(atomic_long_t* p, long expected, long desired){
+#ifdef _MSC_VER
+  return _InterlockedCompareExchange(p,desired,expected) == expected;
+#else
+  return __sync_bool_compare_and_swap(p,expected,desired);
+#endif
+}
+
+// Add D to *P and return the new value.
+inline long atomic_add(atomic_long_t* p, long d){
+#ifdef _MSC_VER
+  return _InterlockedExchangeAdd(p,d) + d;
+#else
+  return __sync_add_and_fetch(p,d);
+#endif
+}
+
+
+#endif // ATOMIC_OPS_HH
+
+// atomic_ops.hh ends here
@@ -0,0 +1,150 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 23:06:40 sb"
+
+/*
+  file       band_pool.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "band_pool.hh"
+
+#include <algorithm>
+
+BandPool::BandPool(size_t n_threads)
+  : start(mutex),
+    done(mutex),
+    task(NULL),
+    rows(0),
+    n_bands(0),
+    next_band(0),
+    bands_left(0),
+    active(0),
+    generation(0),
+    quit(false)
+{
+  start_threads(n_threads);
+}
+
+BandPool::~BandPool(){
+  stop_threads();
+}
+
+void BandPool::SetThreadCount(size_t n_threads){
+  stop_threads();
+  start_threads(n_threads);
+}
+
+// Start N_THREADS-1 threads, the caller of Run() is the last one.
+void BandPool::start_threads(size_t n_threads){
+  if(n_threads == 0){
+    int n_cpu = wxThread::GetCPUCount();
+    n_threads = n_cpu > 0 ? n_cpu : 1;
+  }
+  quit = false;
+  for(size_t k=1; k<n_threads; ++k){
+    Thread* t = new Thread(this);
+    if(t->Create() != wxTHREAD_NO_ERROR){
+      delete t;
+      break;
+    }
+    t->Run();
+    threads.push_back(t);
+  }
+}
+
+void BandPool::stop_threads(){
+  mutex.Lock();
+  quit = true;
+  start.Broadcast();
+  mutex.Unlock();
+  for(size_t k=0; k<threads.size(); ++k){
+    threads[k]->Wait();
+    delete threads[k];
+  }
+  threads.clear();
+}
+
+// At least one band, even without rows, so that tasks always get to
+// initialize their results.
+size_t BandPool::GetBandCount(size_t rows) const {
+  if(threads.empty()){
+    return 1;
+  }
+  size_t n = GetThreadCount()*BAND_POOL_BANDS_PER_THREAD;
+  return std::max((size_t)1,std::min(n,rows/BAND_POOL_MIN_ROWS));
+}
+
+// Take bands of task T until there are none left.
+void BandPool::run_bands(BandTask* t, size_t r, size_t n){
+  size_t finished = 0;
+  for(;;){
+    long b = atomic_add(&next_band,1)-1;
+    if(b >= (long)n){
+      break;
+    }
+    t->Run(b,GetBandRow(b,r,n),GetBandRow(b+1,r,n));
+    ++finished;
+  }
+  if(finished){
+    wxMutexLocker lock(mutex);
+    bands_left -= finished;
+    if(bands_left == 0){
+      done.Broadcast();
+    }
+  }
+}
+
+void BandPool::work(){
+  long seen = 0;
+  mutex.Lock();
+  for(;;){
+    while(!quit && (generation == seen || !task)){
+      start.Wait();
+    }
+    if(quit){
+      break;
+    }
+    seen = generation;
+    BandTask* t = task;
+    size_t r = rows, n = n_bands;
+    ++active;
+    mutex.Unlock();
+    run_bands(t,r,n);
+    mutex.Lock();
+    // Run() does not return before all threads that joined the task
+    // left it, so none of them takes a band of the next task.
+    if(--active == 0){
+      done.Broadcast();
+    }
+  }
+  mutex.Unlock();
+}
+
+void BandPool::Run(BandTask& t, size_t r){
+  size_t n = GetBandCount(r);
+  if(n == 1){
+    t.Run(0,0,r);
+    return;
+  }
+  mutex.Lock();
+  task = &t;
+  rows = r;
+  n_bands = n;
+  bands_left = n;
+  atomic_set(&next_band,0);
+  ++generation;
+  start.Broadcast();
+  mutex.Unlock();
+
+  run_bands(&t,r,n);
+
+  mutex.Lock();
+  while(bands_left > 0 || active > 0){
+    done.Wait();
+  }
+  task = NULL;
+  mutex.Unlock();
+}
+
+// band_pool.cc ends here
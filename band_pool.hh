@@ -0,0 +1,100 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 22:52:14 sb"
+
+/*
+  file       band_pool.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef BAND_POOL_HH
+#define BAND_POOL_HH
+
+#include <wx/thread.h>
+#include <cstddef>
+#include <vector>
+
+#include "atomic_ops.hh"
+
+// Default number of image processing threads, 0 uses one per core
+#define BAND_POOL_THREADS 0
+
+// Bands per thread. More bands than threads even out bands that take
+// longer, e.g. where the ROI covers only part of them.
+#define BAND_POOL_BANDS_PER_THREAD 4
+
+// Image rows below which a band is not worth handing to another
+// thread
+#define BAND_POOL_MIN_ROWS 16
+
+// Work on image rows, split into bands by BandPool::Run().
+class BandTask {
+  public:
+    virtual ~BandTask() {}
+    // Process rows [ROW0, ROW1) as band number BAND. Runs concurrently
+    // with the other bands, so only write to the rows and the
+    // per-band results of BAND.
+    virtual void Run(size_t band, size_t row0, size_t row1) = 0;
+};
+
+/*
+  Fixed set of threads that process the rows of an image in
+  parallel. Run() splits the rows into bands, which the threads and
+  the calling thread take in turn until all are done. The split only
+  depends on the number of rows and threads, so tasks that reduce
+  per-band results in band order get the same result every time.
+ */
+class BandPool {
+  private:
+    class Thread : public wxThread {
+      private:
+        BandPool* pool;
+      public:
+        Thread(BandPool* pool_) : wxThread(wxTHREAD_JOINABLE), pool(pool_) {}
+        virtual void* Entry(){ pool->work(); return NULL; }
+    };
+
+    std::vector<Thread*> threads;
+    wxMutex mutex; // protects everything below but next_band
+    wxCondition start; // signaled when a task is posted or on quit
+    wxCondition done; // signaled when the last band finished
+    BandTask* task; // current task, NULL between Run() calls
+    size_t rows;
+    size_t n_bands;
+    atomic_long_t next_band; // next band to take
+    size_t bands_left; // bands not finished yet
+    size_t active; // threads working on the current task
+    long generation; // number of tasks posted so far
+    bool quit;
+
+    BandPool(const BandPool&) : start(mutex), done(mutex) {}
+    void start_threads(size_t n_threads);
+    void stop_threads();
+    void work();
+    void run_bands(BandTask* t, size_t r, size_t n);
+
+  public:
+    // N_THREADS includes the thread calling Run(), 0 uses one per
+    // core.
+    BandPool(size_t n_threads=BAND_POOL_THREADS);
+    ~BandPool();
+
+    void SetThreadCount(size_t n_threads);
+    size_t GetThreadCount() const {return threads.size()+1;}
+
+    // Number of bands Run() splits ROWS rows into, at least one
+    size_t GetBandCount(size_t rows) const;
+    // First row of BAND when splitting ROWS rows into N_BANDS bands
+    static size_t GetBandRow(size_t band, size_t rows, size_t n_bands){
+      return band*rows/n_bands;
+    }
+
+    // Run TASK on rows [0, ROWS) and return when all bands are done.
+    void Run(BandTask& task, size_t rows);
+};
+
+
+#endif // BAND_POOL_HH
+
+// band_pool.hh ends here
@@ -11,14 +11,19 @@
 #include "camera.hh"
 #include "camera_worker.hh"
 #include "andor_error_codes.hh"
+#include "andor_driver.hh"
+#include "frame_ring.hh"
+#include "telemetry.hh"
+#include "monotonic_clock.hh"
 
-#include <ATMCD32D.H>
 
 #include <sstream>
+#include <algorithm>
 
 
-Camera::Camera(CameraWorker* owner_)
+Camera::Camera(CameraWorker* owner_, bool simulate, int index)
   : owner(owner_),
+    drv(NULL),
     initialized(false),
     width(0),
     height(0),
@@ -30,12 +35,29 @@ Camera::Camera(CameraWorker* owner_)
     tmax(0),
     readouttime(0),
     using_kinetics(false),
+    using_streaming(false),
     n_kinetics(0),
-    rows_kinetics(0)
+    rows_kinetics(0),
+    hbin(ANDOR_HBIN),
+    vbin(ANDOR_VBIN),
+    readout_x(0),
+    readout_y(0),
+    readout_width(0),
+    readout_height(0),
+    timings_valid(false),
+    circular_buffer(0),
+    next_image(1),
+    acquisition_signaled(false)
 {
+  timings[0] = timings[1] = timings[2] = 0;
+  drv = create_andor_driver(simulate,index);
 }
 
 Camera::~Camera(){
+  if(drv){
+    delete drv;
+    drv = NULL;
+  }
 }
 
 
@@ -43,17 +65,19 @@ bool Camera::Initialize() {
   bool rc = false;
   int ret = DRV_SUCCESS;
   std::ostringstream os;
-  os << "Initialize DLL";
+  os << "Initialize " << drv->GetName();
   owner->log_message(os.str()); os.str("");
+  applied = CameraSettings();
+  timings_valid = false;
 
-  if((ret=::Initialize(ANDOR_DRIVER_DIRECTORY))!=DRV_SUCCESS){
+  if((ret=drv->Initialize((char*)ANDOR_DRIVER_DIRECTORY))!=DRV_SUCCESS){
     os << "Initialize()";
     goto error;
   }
   int t1=0,t2=0;
   float t[2] ={0,0};
   int s = 0, i=0, j=0, k=0, l=0;
-  if(::GetDetector(&t1,&t2)!=DRV_SUCCESS){
+  if(drv->GetDetector(&t1,&t2)!=DRV_SUCCESS){
     os << "GetDetector()";
     goto error;
   }
@@ -63,7 +87,7 @@ bool Camera::Initialize() {
   owner->log_message(os.str()); os.str("");
 
   t1=t2=0;
-  if((ret=::GetNumberADChannels(&t1))!=DRV_SUCCESS){
+  if((ret=drv->GetNumberADChannels(&t1))!=DRV_SUCCESS){
     os << "GetNumberADChannels()";
     goto error;
   }
@@ -72,7 +96,7 @@ bool Camera::Initialize() {
   owner->log_message(os.str()); os.str("");
 
   t1=t2=0;
-  if((ret=::GetNumberAmp(&t1))!=DRV_SUCCESS){
+  if((ret=drv->GetNumberAmp(&t1))!=DRV_SUCCESS){
     os << "GetNumberAmp()";
     goto error;
   }
@@ -81,14 +105,14 @@ bool Camera::Initialize() {
   owner->log_message(os.str()); os.str("");
 
   t1=t2=0;
-  if((ret=::GetNumberPreAmpGains(&t1))!=DRV_SUCCESS){
+  if((ret=drv->GetNumberPreAmpGains(&t1))!=DRV_SUCCESS){
     os << "GetNumberPreAmpGains()";
     goto error;
   }
   preamps = t1;
   os << "Preamp gain settings : (";
   for(i = 0; i<preamps; ++i){
-    if((ret=::GetPreAmpGain(i,&t[0]))!=DRV_SUCCESS){
+    if((ret=drv->GetPreAmpGain(i,&t[0]))!=DRV_SUCCESS){
       os.str("");
       os << "GetPreAmpGain(" << i <<")";
       goto error;
@@ -102,7 +126,7 @@ bool Camera::Initialize() {
   os << ")";
   owner->log_message(os.str()); os.str("");
 
-  if((ret=::SetPreAmpGain(preamps-1))!=DRV_SUCCESS){
+  if((ret=drv->SetPreAmpGain(preamps-1))!=DRV_SUCCESS){
     os << "SetPreAmpGain(" << preamps-1 << ")";
     goto error;
   }
@@ -110,7 +134,7 @@ bool Camera::Initialize() {
   owner->log_message(os.str()); os.str("");
 
   t1=t2=0;
-  if((ret=::GetBitDepth(0,&t1))!=DRV_SUCCESS){
+  if((ret=drv->GetBitDepth(0,&t1))!=DRV_SUCCESS){
     os << "GetBitDepth(0)";
     goto error;
   }
@@ -119,14 +143,14 @@ bool Camera::Initialize() {
   owner->log_message(os.str()); os.str("");
 
   // Set to maximum vertical speed
-  if((ret=::GetNumberVSSpeeds(&s))!=DRV_SUCCESS){
+  if((ret=drv->GetNumberVSSpeeds(&s))!=DRV_SUCCESS){
     os << "GetNumberVSSpeeds()";
     goto error;
   }
   t[0] = 0;
   j=0;
   for(i=0; i<s; ++i){
-    if((ret=::GetVSSpeed(i,&t[1]))!=DRV_SUCCESS){
+    if((ret=drv->GetVSSpeed(i,&t[1]))!=DRV_SUCCESS){
       os << "GetVSSpeed()";
       goto error;
     }
@@ -135,7 +159,7 @@ bool Camera::Initialize() {
       j=i;
     }
   }
-  if((ret=::SetVSSpeed(j))!=DRV_SUCCESS){
+  if((ret=drv->SetVSSpeed(j))!=DRV_SUCCESS){
     os << "SetVSSpeed()";
     goto error;
   }
@@ -147,12 +171,12 @@ bool Camera::Initialize() {
 
   // set horizontal speed to max
   for(i=0; i<adchannels; ++i){
-    if((ret=::GetNumberHSSpeeds(i,0,&s))!=DRV_SUCCESS){
+    if((ret=drv->GetNumberHSSpeeds(i,0,&s))!=DRV_SUCCESS){
       os << "GetNumberHSSpeeds()";
       goto error;
     }
     for(j=0; j<s; ++j){
-      if((ret=::GetHSSpeed(i,0,j,&t[1]))!=DRV_SUCCESS){
+      if((ret=drv->GetHSSpeed(i,0,j,&t[1]))!=DRV_SUCCESS){
         os << "GetHSSpeed()";
         goto error;
       }
@@ -163,13 +187,13 @@ bool Camera::Initialize() {
       }
     }
   }
-  if((ret=::SetADChannel(l))!=DRV_SUCCESS){
+  if((ret=drv->SetADChannel(l))!=DRV_SUCCESS){
     os << "SetADChannel()";
     goto error;
   }
   os << "AD Channel: " << l;
   owner->log_message(os.str()); os.str("");
-  if((ret=::SetHSSpeed(0,k))!=DRV_SUCCESS){
+  if((ret=drv->SetHSSpeed(0,k))!=DRV_SUCCESS){
     os << "SetHSSpeed()";
     goto error;
   }
@@ -178,7 +202,7 @@ bool Camera::Initialize() {
 
 
   t1=t2=0;
-  if((ret=::GetTemperatureRange(&t1,&t2))!=DRV_SUCCESS){
+  if((ret=drv->GetTemperatureRange(&t1,&t2))!=DRV_SUCCESS){
     os << "GetTemperatureRange()";
     goto error;
   }
@@ -187,14 +211,14 @@ bool Camera::Initialize() {
   os << "Temperature range: [" << t1 << "," << t2 << "]";
   owner->log_message(os.str()); os.str("");
 
-  if((ret=::SetTemperature(ANDOR_CAMERA_TEMPERATURE))!=DRV_SUCCESS){
+  if((ret=drv->SetTemperature(ANDOR_CAMERA_TEMPERATURE))!=DRV_SUCCESS){
     os << "SetTemperature(" << ANDOR_CAMERA_TEMPERATURE << ")";
     goto error;
   }
   os << "Temperature set to " << ANDOR_CAMERA_TEMPERATURE << " C";
   owner->log_message(os.str()); os.str("");
 
-  if((ret=::CoolerON())!=DRV_SUCCESS){
+  if((ret=drv->CoolerON())!=DRV_SUCCESS){
     os << "CoolerON()";
     goto error;
   }
@@ -216,7 +240,7 @@ int Camera::GetTemperature() {
   if(!initialized){
     return t;
   }
-  unsigned int rc = ::GetTemperature(&t);
+  unsigned int rc = drv->GetTemperature(&t);
   if(rc == DRV_TEMP_STABILIZED ||
      rc == DRV_TEMP_NOT_REACHED ||
      rc == DRV_TEMP_DRIFT ||
@@ -231,115 +255,283 @@ int Camera::GetTemperature() {
   return t;
 }
 
-bool Camera::SetupExperiment(float exposure_time,
-                             shutter_mode_t shutter_mode,
-                             bool internal_trigger,
-                             bool kinetics_mode,
-                             unsigned int number_kinetics
-                            )
-{
+// Sample temperature, cooler and acquisition status into S for the
+// telemetry thread. Failing driver calls leave the fields unknown
+// and are not logged, since this runs every second.
+bool Camera::ReadTelemetry(TelemetrySample& s){
+  if(!initialized){
+    return false;
+  }
+  s.t = monotonic_ms();
+  float t = 0;
+  unsigned int rc = drv->GetTemperatureF(&t);
+  if(rc == DRV_TEMP_STABILIZED || rc == DRV_TEMP_NOT_REACHED ||
+     rc == DRV_TEMP_DRIFT || rc == DRV_TEMP_NOT_STABILIZED || rc == DRV_TEMP_OFF)
+  {
+    s.temperature = t;
+    s.temperature_status = rc;
+  }
+  int cooler = 0;
+  if(drv->IsCoolerOn(&cooler) == DRV_SUCCESS){
+    s.cooler = cooler ? 1 : 0;
+  }
+  int status = 0;
+  if(drv->GetStatus(&status) == DRV_SUCCESS){
+    s.status = status;
+  }
+  return true;
+}
+
+/*
+  Fit the readout area and binning requested in CTL to the chip. The
+  binned area has to hold a whole number of super pixels, so it gets
+  shrunk to the next multiple of the binning. In fast kinetics mode,
+  the full chip width is read out, every kinetics image has the same
+  number of rows, and the exposed area needs to sit above the
+  (n_kinetics-1) storage images that are shifted down the chip.
+ */
+void Camera::fit_readout(const CameraExperimentControl& ctl){
+  hbin = std::max(1,std::min((int)ctl.hbin,width));
+  vbin = std::max(1,std::min((int)ctl.vbin,height));
+
+  int x = 0, w = width, y = 0, h = height;
+  if(!using_kinetics){
+    x = std::max(0,std::min(ctl.readout_x,width-1));
+    if(ctl.readout_width > 0){
+      w = std::min(ctl.readout_width,width-x);
+    }
+    else{
+      w = width-x;
+    }
+    y = std::max(0,std::min(ctl.readout_y,height-1));
+    if(ctl.readout_height > 0){
+      h = std::min(ctl.readout_height,height-y);
+    }
+    else{
+      h = height-y;
+    }
+  }
+  else{
+    int max_rows = height/n_kinetics;
+    vbin = std::min(vbin,max_rows);
+    h = max_rows;
+    if(ctl.readout_height > 0){
+      h = std::min(ctl.readout_height,max_rows);
+    }
+    h = std::max(vbin,h - h%vbin);
+    y = (n_kinetics-1)*h;
+    if(ctl.readout_height > 0){
+      y = std::min(std::max(ctl.readout_y,y),height-h);
+    }
+  }
+  w = std::max(hbin,w - w%hbin);
+  x = std::min(x,width-w);
+  h = std::max(vbin,h - h%vbin);
+  y = std::min(y,height-h);
+
+  readout_x = x;
+  readout_y = y;
+  readout_width = w/hbin;
+  readout_height = h/vbin;
+}
+
+/*
+  Configure the driver for CTL. The configuration last applied is
+  cached in APPLIED and only settings that differ get pushed to the
+  driver, so repeating a run with the same settings does not talk to
+  the camera at all. Changing the acquisition mode resets the cache,
+  since the driver interprets several settings per mode. Acquisition
+  timings are queried only when something changed.
+ */
+bool Camera::SetupExperiment(const CameraExperimentControl& ctl){
   bool ret = false;
   if(!initialized){
     return ret;
   }
   int rc = DRV_SUCCESS;
-  float t[3] ={0,0,0};
-  int i=0;
+  size_t changed = 0;
+  at_32 nbuf = 0;
+  CameraSettings want;
   std::ostringstream os;
+  float exposure_time = ctl.exposure_time;
+  bool kinetics_mode = ctl.kinetics_mode;
+  bool streaming = ctl.streaming;
 
-  // Use either fast kinetics mode or single image
-  if((rc=::SetAcquisitionMode(kinetics_mode?4:1))!=DRV_SUCCESS){
-    os << "SetAcquisitionMode()";
-    goto error;
+  // Fast kinetics is a single acquisition of a whole series, so it
+  // cannot run until abort.
+  using_streaming = streaming && !kinetics_mode;
+  if(streaming && kinetics_mode){
+    owner->log_message("Streaming not available in fast kinetics mode, "
+                       "re-arming for every image instead.");
   }
 
-  // Always read full image
-  if((rc=::SetReadMode(4))!=DRV_SUCCESS){
-    os << "SetReadMode()";
-    goto error;
-  }
+  // Choose readout area and binning
+  using_kinetics = kinetics_mode;
+  n_kinetics = using_kinetics ? std::max(1u,ctl.number_kinetics) : 1;
+  fit_readout(ctl);
+  os << "Readout area : " << readout_width*hbin << " x "
+     << readout_height*vbin << " px at (" << readout_x << ", "
+     << readout_y << "), binning " << hbin << " x " << vbin;
+  owner->log_message(os.str()); os.str("");
 
-  // Set exposure time
-  if((rc=::SetExposureTime(exposure_time))!=DRV_SUCCESS){
-    os << "SetExposureTime()";
-    goto error;
+  // Use either fast kinetics mode, run till abort, or single image,
+  // and always read full image
+  want.acquisition_mode = kinetics_mode?4:(using_streaming?5:1);
+  want.read_mode = 4;
+  want.exposure_time = exposure_time;
+  if(using_kinetics){
+    rows_kinetics = readout_height;
+    want.fk_rows = readout_height*vbin;
+    want.fk_series = n_kinetics;
+    want.fk_exposure_time = exposure_time;
+    want.fk_hbin = hbin;
+    want.fk_vbin = vbin;
+    want.fk_offset = readout_y;
+  }
+  // Run till abort as fast as readout (or the trigger) allows
+  if(using_streaming){
+    want.kinetic_cycle_time = 0.0f;
   }
 
-  // Setup fast kinetics mode if requested
-  using_kinetics = kinetics_mode;
+  // Setup Shutter
+  if (ctl.shutter_mode==AUTOMATIC)         {want.shutter_mode = 0;}
+  else if (ctl.shutter_mode==ALWAYS_OPEN)  {want.shutter_mode = 1;}
+  else if (ctl.shutter_mode==ALWAYS_CLOSED){want.shutter_mode = 2;}
+  else                                 {want.shutter_mode = ANDOR_SHUTTER_MODE;}
+
+  // Setup trigger polarity is such that TTL high triggers
+  want.trigger_mode = ctl.internal_trigger?0:1;
+
+  // Setup ROI for readout and binning. Fast kinetics only uses the
+  // horizontal range, the rows were chosen above.
+  want.image_hstart = readout_x+1;
+  want.image_hend = readout_x+readout_width*hbin;
   if(using_kinetics){
-    n_kinetics = number_kinetics;
-    rows_kinetics = height/n_kinetics;
-    if((rc=::SetFastKineticsEx(rows_kinetics,n_kinetics,exposure_time,4,
-                               ANDOR_HBIN,ANDOR_VBIN,(n_kinetics-1)*rows_kinetics
-                              ))!=DRV_SUCCESS)
-    {
-      os << "SetFastKinetics()";
+    want.image_vstart = 1;
+    want.image_vend = height-height%vbin;
+  }
+  else{
+    want.image_vstart = readout_y+1;
+    want.image_vend = readout_y+readout_height*vbin;
+  }
+  want.image_hbin = hbin;
+  want.image_vbin = vbin;
+
+  if(want.acquisition_mode != applied.acquisition_mode){
+    applied = CameraSettings();
+    if((rc=drv->SetAcquisitionMode(want.acquisition_mode))!=DRV_SUCCESS){
+      os << "SetAcquisitionMode()";
       goto error;
     }
+    applied.acquisition_mode = want.acquisition_mode;
+    ++changed;
   }
 
-  // Query final timing from camera
-  //   GetReadOutTime() does not exist for iKon model!
-  if((rc=::GetAcquisitionTimings(&t[0],&t[1],&t[2]))!=DRV_SUCCESS){
-    os << "GetAcquisitionTimings()";
-    goto error;
+  if(want.read_mode != applied.read_mode){
+    if((rc=drv->SetReadMode(want.read_mode))!=DRV_SUCCESS){
+      os << "SetReadMode()";
+      goto error;
+    }
+    applied.read_mode = want.read_mode;
+    ++changed;
   }
-  os << "Acquisition timings : exposure:" << t[0] << ", accumulate:"
-     << t[1] << ", kinetic: " << t[2];
-  owner->log_message(os.str()); os.str("");
-
 
-  // Setup Shutter
-  if (shutter_mode==AUTOMATIC)         {i = 0;}
-  else if (shutter_mode==ALWAYS_OPEN)  {i = 1;}
-  else if (shutter_mode==ALWAYS_CLOSED){i = 2;}
-  else                                 {i = ANDOR_SHUTTER_MODE;}
-  if((rc=::SetShutter(ANDOR_SHUTTER_TTL,i,
-                      ANDOR_SHUTTER_CLOSETIME,
-                      ANDOR_SHUTTER_OPENTIME))!=DRV_SUCCESS)
-  {
-    os << "SetShutter()";
-    goto error;
+  if(want.exposure_time != applied.exposure_time){
+    if((rc=drv->SetExposureTime(want.exposure_time))!=DRV_SUCCESS){
+      os << "SetExposureTime()";
+      goto error;
+    }
+    applied.exposure_time = want.exposure_time;
+    ++changed;
   }
 
+  if(using_kinetics && !want.SameFastKinetics(applied)){
+    if((rc=drv->SetFastKineticsEx(want.fk_rows,want.fk_series,want.fk_exposure_time,4,
+                                  want.fk_hbin,want.fk_vbin,want.fk_offset
+                                 ))!=DRV_SUCCESS)
+    {
+      os << "SetFastKinetics()";
+      goto error;
+    }
+    applied.SetFastKinetics(want);
+    ++changed;
+  }
 
-  // Setup trigger polarity is such that TTL high triggers
-  i = internal_trigger?0:1;
-  if((rc=::SetTriggerMode(i))!=DRV_SUCCESS){
-    os << "SetTriggerMode()";
-    goto error;
+  if(using_streaming && want.kinetic_cycle_time != applied.kinetic_cycle_time){
+    if((rc=drv->SetKineticCycleTime(want.kinetic_cycle_time))!=DRV_SUCCESS){
+      os << "SetKineticCycleTime()";
+      goto error;
+    }
+    applied.kinetic_cycle_time = want.kinetic_cycle_time;
+    ++changed;
   }
 
-  // Setup ROI for readout and binning, always use full chip here
-  if((rc=::SetImage(ANDOR_HBIN,ANDOR_VBIN,1,width,1,height))!=DRV_SUCCESS){
-    os << "SetImage()";
-    goto error;
+  if(want.shutter_mode != applied.shutter_mode){
+    if((rc=drv->SetShutter(ANDOR_SHUTTER_TTL,want.shutter_mode,
+                           ANDOR_SHUTTER_CLOSETIME,
+                           ANDOR_SHUTTER_OPENTIME))!=DRV_SUCCESS)
+    {
+      os << "SetShutter()";
+      goto error;
+    }
+    applied.shutter_mode = want.shutter_mode;
+    ++changed;
   }
 
-/*
-  if((rc=::SetNumberAccumulations(1))!=DRV_SUCCESS){
-     os << "SetNumberAccumulations()";
-     goto error;
+  if(want.trigger_mode != applied.trigger_mode){
+    if((rc=drv->SetTriggerMode(want.trigger_mode))!=DRV_SUCCESS){
+      os << "SetTriggerMode()";
+      goto error;
+    }
+    applied.trigger_mode = want.trigger_mode;
+    ++changed;
   }
-  if((rc=::SetNumberKinetics(1))!=DRV_SUCCESS){
-    os << "SetNumberKinetics()";
-    goto error;
+
+  if(!want.SameImage(applied)){
+    if((rc=drv->SetImage(want.image_hbin,want.image_vbin,
+                         want.image_hstart,want.image_hend,
+                         want.image_vstart,want.image_vend))!=DRV_SUCCESS)
+    {
+      os << "SetImage()";
+      goto error;
+    }
+    applied.SetImage(want);
+    ++changed;
   }
-  if((rc=::SetAccumulationCycleTime(1.0f))!=DRV_SUCCESS){
-    os << "SetAccumulationCycleTime()";
-    goto error;
+
+  // Query final timing from camera, and the circular buffer size,
+  // which depends on the image size
+  //   GetReadOutTime() does not exist for iKon model!
+  if(changed || !timings_valid){
+    if((rc=drv->GetAcquisitionTimings(&timings[0],&timings[1],&timings[2]))!=DRV_SUCCESS){
+      os << "GetAcquisitionTimings()";
+      goto error;
+    }
+    if(using_streaming && (rc=drv->GetSizeOfCircularBuffer(&nbuf))!=DRV_SUCCESS){
+      os << "GetSizeOfCircularBuffer()";
+      goto error;
+    }
+    circular_buffer = nbuf;
+    timings_valid = true;
   }
-  if((rc=::SetKineticCycleTime(1.0f))!=DRV_SUCCESS){
-    os << "SetKineticCycleTime()";
-    goto error;
+  os << "Acquisition timings" << (changed?"":" (unchanged)") << " : exposure:"
+     << timings[0] << ", accumulate:" << timings[1] << ", kinetic: " << timings[2];
+  owner->log_message(os.str()); os.str("");
+  if(using_streaming){
+    os << "Streaming into circular buffer of " << circular_buffer << " images";
+    owner->log_message(os.str()); os.str("");
   }
-*/
 
-  owner->log_message("Experiment set up successfully.");
+  os << "Experiment set up successfully, " << changed << " driver setting"
+     << (changed==1?"":"s") << " changed.";
+  owner->log_message(os.str());
   ret = true;
   goto exit;
 error:
+  // The driver state is unknown after a failure, so push everything
+  // next time.
+  applied = CameraSettings();
+  timings_valid = false;
   os << " failed with " << andor_strerr(rc);
   owner->log_error(os.str()); os.str("");
 exit:
@@ -351,8 +543,10 @@ bool Camera::StartExperiment() {
     return false;
   }
   unsigned int rc = DRV_SUCCESS;
-  if((rc=::StartAcquisition())!=DRV_SUCCESS){
-    ::AbortAcquisition();
+  next_image = 1; // the driver counts images from 1 for every acquisition
+  acquisition_signaled = false;
+  if((rc=drv->StartAcquisition())!=DRV_SUCCESS){
+    drv->AbortAcquisition();
     std::ostringstream os;
     os << "StartAcquisition() failed with " << andor_strerr(rc);
     owner->log_error(os.str()); os.str("");
@@ -368,7 +562,7 @@ int Camera::GetStatus(){
   unsigned int rc = DRV_SUCCESS;
   int status=0;
   std::ostringstream os;
-  if((rc=::GetStatus(&status))!=DRV_SUCCESS){
+  if((rc=drv->GetStatus(&status))!=DRV_SUCCESS){
     os << "GetStatus() failed with " << andor_strerr(rc);
     owner->log_error(os.str()); os.str("");
     return 0;
@@ -394,10 +588,60 @@ int Camera::GetStatus(){
   return 4;
 }
 
-// Assume that raw_image_data is allocated with dimensions given by
-// width*height. Also assume that raw_image_data is already mutex
-// protected by caller.
-bool Camera::DownloadImage(long** raw_image_data){
+/*
+  Block until the driver signals the end of the acquisition, at most
+  TIMEOUT_MS milliseconds. Return values follow GetStatus(): 3 if the
+  acquisition is done, 2 if the camera is still acquiring (timeout or
+  CancelWait() from another thread), 1 or 0 on errors.
+
+  The driver signals each acquisition once. Outside of run till abort
+  mode, a timeout therefore falls back to the driver status, which
+  also notices an acquisition whose event got lost. The event may
+  fire shortly before the driver reports idle, so afterwards the
+  status is polled every ANDOR_SETTLE_PERIOD_MS until it does.
+ */
+int Camera::WaitForAcquisition(int timeout_ms){
+  if(!initialized){
+    return -1;
+  }
+  if(using_streaming || !acquisition_signaled){
+    unsigned int rc = drv->WaitForAcquisitionTimeOut(timeout_ms);
+    if(rc == DRV_NO_NEW_DATA){
+      return using_streaming ? 2 : GetStatus();
+    }
+    if(rc != DRV_SUCCESS){
+      std::ostringstream os;
+      os << "WaitForAcquisitionTimeOut() failed with " << andor_strerr(rc);
+      owner->log_error(os.str()); os.str("");
+      return 0;
+    }
+    // While streaming, the event signals a new image and the camera
+    // keeps acquiring.
+    if(using_streaming){
+      return 3;
+    }
+    acquisition_signaled = true;
+  }
+  int i = GetStatus();
+  for(int t=0; i==2 && t<timeout_ms; t+=ANDOR_SETTLE_PERIOD_MS){
+    wxThread::Sleep(ANDOR_SETTLE_PERIOD_MS);
+    i = GetStatus();
+  }
+  return i;
+}
+
+// Wake up a thread blocked in WaitForAcquisition(). Safe to call from
+// any thread.
+void Camera::CancelWait(){
+  if(!initialized){
+    return;
+  }
+  drv->CancelWait();
+}
+
+// Download the acquired image(s) into FRAME, which is owned by the
+// caller and has to hold at least width*height pixels.
+bool Camera::DownloadImage(Frame* frame){
   if(!initialized){
     return false;
   }
@@ -407,7 +651,7 @@ bool Camera::DownloadImage(long** raw_image_data){
   at_32 t1=0,t2=0;
   long n1=0,n2=0;
   unsigned int n=0;
-  if((rc=::GetNumberAvailableImages(&t1,&t2))!=DRV_SUCCESS){
+  if((rc=drv->GetNumberAvailableImages(&t1,&t2))!=DRV_SUCCESS){
     os << "GetNumberAvailableImages()";
     goto error;
   }
@@ -422,15 +666,29 @@ bool Camera::DownloadImage(long** raw_image_data){
 //     goto error;
 //   }
   if(t1==1 && t2==1){
-    n = GetImageArea();
+    n = readout_width*readout_height;
+    frame->height = readout_height;
+    frame->n_images = 1;
   }
   else{
-    n = (t2-t1+1)*rows_kinetics*width;
+    n = (t2-t1+1)*rows_kinetics*readout_width;
+    frame->height = (t2-t1+1)*rows_kinetics;
+    frame->n_images = t2-t1+1;
+  }
+  frame->width = readout_width;
+  frame->x0 = readout_x;
+  frame->y0 = readout_y;
+  frame->hbin = hbin;
+  frame->vbin = vbin;
+  if(n > frame->capacity){
+    os << "DownloadImage() frame buffer too small for " << n << " px";
+    owner->log_error(os.str()); os.str("");
+    return false;
   }
   n1 = t1, n2 = t2;
   t1 = t2 = 0;
-  if((rc=::GetImages(n1,n2,*raw_image_data,n,&t1,&t2))!=DRV_SUCCESS){
-    os << "GetImages()";
+  if((rc=drv->GetImages16(n1,n2,frame->data,n,&t1,&t2))!=DRV_SUCCESS){
+    os << "GetImages16()";
     goto error;
   }
 
@@ -443,27 +701,61 @@ exit:
   return ret;
 }
 
-bool Camera::SaveLastImageTIFF(const std::string& path){
+/*
+  While streaming, copy the next image not yet retrieved from the
+  driver's circular buffer into FRAME. Images the driver overwrote
+  before we got to them are skipped and counted in SKIPPED. Returns 1
+  if an image was downloaded, 0 if there is no new image, and -1 on
+  errors.
+ */
+int Camera::DownloadNextImage(Frame* frame, long& skipped){
+  skipped = 0;
   if(!initialized){
-    return false;
+    return -1;
   }
-  unsigned int rc=DRV_SUCCESS;
-  size_t n = (using_kinetics)?n_kinetics:1;
-  std::ostringstream os;
-  for(size_t i=0; i<n; ++i){
-    os.str("");
-    os << path << "_" << i;
-    if((rc=::SaveAsTiffEx((char*)os.str().c_str(),ANDOR_PALETTE,i+1,1,1))!=DRV_SUCCESS){
-      std::ostringstream os;
-      os << "SaveAsTiffEx() failed with " << andor_strerr(rc);
-      owner->log_error(os.str()); os.str("");
-      return false;
+  unsigned long n = readout_width*readout_height;
+  if(n > frame->capacity){
+    std::ostringstream os;
+    os << "DownloadNextImage() frame buffer too small for " << n << " px";
+    owner->log_error(os.str()); os.str("");
+    return -1;
+  }
+  unsigned int rc = DRV_SUCCESS;
+  at_32 first = 0, last = 0, validfirst = 0, validlast = 0;
+  // The driver may overwrite the image we ask for between the two
+  // calls, then look again.
+  for(int attempt=0; attempt<ANDOR_DOWNLOAD_ATTEMPTS; ++attempt){
+    rc = drv->GetNumberAvailableImages(&first,&last);
+    if(rc == DRV_NO_NEW_DATA || (rc == DRV_SUCCESS && last < next_image)){
+      return 0;
+    }
+    if(rc != DRV_SUCCESS){
+      break;
+    }
+    at_32 k = std::max(first,(at_32)next_image);
+    rc = drv->GetImages16(k,k,frame->data,n,&validfirst,&validlast);
+    if(rc == DRV_SUCCESS){
+      skipped = k - next_image;
+      next_image = k + 1;
+      frame->width = readout_width;
+      frame->height = readout_height;
+      frame->n_images = 1;
+      frame->x0 = readout_x;
+      frame->y0 = readout_y;
+      frame->hbin = hbin;
+      frame->vbin = vbin;
+      return 1;
+    }
+    if(rc != DRV_P1INVALID){
+      break;
     }
   }
-  return true;
+  std::ostringstream os;
+  os << "GetImages16() failed with " << andor_strerr(rc);
+  owner->log_error(os.str()); os.str("");
+  return -1;
 }
 
-
 bool Camera::AbortExperiment() {
   bool ret = false;
   if(!initialized){
@@ -472,12 +764,12 @@ bool Camera::AbortExperiment() {
   unsigned int rc=DRV_SUCCESS;
   int t=0;
   std::ostringstream os;
-  if((rc=::GetStatus(&t))!=DRV_SUCCESS){
+  if((rc=drv->GetStatus(&t))!=DRV_SUCCESS){
     os << "GetStatus()";
     goto error;
   }
   if(t != DRV_IDLE){
-    if((rc=::AbortAcquisition())!=DRV_SUCCESS){
+    if((rc=drv->AbortAcquisition())!=DRV_SUCCESS){
       os << "AbortAcquisition()";
       goto error;
     }
@@ -499,19 +791,19 @@ void Camera::Shutdown(){
   unsigned int rc = DRV_SUCCESS;
   std::ostringstream os;
 
-  if((rc=::FreeInternalMemory())!=DRV_SUCCESS){
+  if((rc=drv->FreeInternalMemory())!=DRV_SUCCESS){
     os << "FreeInternalMemory() failed with " << andor_strerr(rc);
     owner->log_error(os.str()); os.str("");
   }
 
-  if((rc=::CoolerOFF())!=DRV_SUCCESS){
+  if((rc=drv->CoolerOFF())!=DRV_SUCCESS){
     os << "CoolerOFF() failed with " << andor_strerr(rc);
     owner->log_error(os.str()); os.str("");
   }
   else{
     owner->log_message("Cooler turned off");
   }
-  if((rc=::ShutDown())!=DRV_SUCCESS){
+  if((rc=drv->ShutDown())!=DRV_SUCCESS){
     os << "ShutDown() failed with " << andor_strerr(rc);
     owner->log_error(os.str()); os.str("");
   }
@@ -527,10 +819,10 @@ wxString Camera::GetVersionInformation(){
   char buf[256];
   memset(buf,0,sizeof(buf));
   std::string rc = "";
-  if(GetVersionInfo(AT_DeviceDriverVersion,buf,sizeof(buf)) == DRV_SUCCESS){
+  if(drv->GetVersionInfo(AT_DeviceDriverVersion,buf,sizeof(buf)) == DRV_SUCCESS){
     rc += "Driver version " + std::string(buf);
   }
-  if(GetVersionInfo(AT_SDKVersion,buf,sizeof(buf)) == DRV_SUCCESS){
+  if(drv->GetVersionInfo(AT_SDKVersion,buf,sizeof(buf)) == DRV_SUCCESS){
     rc += " SDK version " + std::string(buf);
   }
   return rc;
@@ -18,9 +18,58 @@
 #include "camera_control.hh"
 
 class CameraWorker;
+class Frame;
+class TelemetrySample;
+class AndorDriver;
+
+// Driver settings as passed to the SDK. Negative values mean unknown,
+// so that the next SetupExperiment() pushes them.
+class CameraSettings {
+  public:
+    int acquisition_mode;
+    int read_mode;
+    float exposure_time;
+    int fk_rows, fk_series, fk_hbin, fk_vbin, fk_offset;
+    float fk_exposure_time;
+    float kinetic_cycle_time;
+    int shutter_mode;
+    int trigger_mode;
+    int image_hbin, image_vbin, image_hstart, image_hend, image_vstart, image_vend;
+
+    CameraSettings()
+      : acquisition_mode(-1), read_mode(-1), exposure_time(-1),
+        fk_rows(-1), fk_series(-1), fk_hbin(-1), fk_vbin(-1), fk_offset(-1),
+        fk_exposure_time(-1), kinetic_cycle_time(-1), shutter_mode(-1),
+        trigger_mode(-1), image_hbin(-1), image_vbin(-1), image_hstart(-1),
+        image_hend(-1), image_vstart(-1), image_vend(-1)
+    {}
+
+    bool SameFastKinetics(const CameraSettings& s) const {
+      return fk_rows == s.fk_rows && fk_series == s.fk_series &&
+        fk_hbin == s.fk_hbin && fk_vbin == s.fk_vbin &&
+        fk_offset == s.fk_offset && fk_exposure_time == s.fk_exposure_time;
+    }
+    void SetFastKinetics(const CameraSettings& s){
+      fk_rows = s.fk_rows; fk_series = s.fk_series; fk_hbin = s.fk_hbin;
+      fk_vbin = s.fk_vbin; fk_offset = s.fk_offset;
+      fk_exposure_time = s.fk_exposure_time;
+    }
+    bool SameImage(const CameraSettings& s) const {
+      return image_hbin == s.image_hbin && image_vbin == s.image_vbin &&
+        image_hstart == s.image_hstart && image_hend == s.image_hend &&
+        image_vstart == s.image_vstart && image_vend == s.image_vend;
+    }
+    void SetImage(const CameraSettings& s){
+      image_hbin = s.image_hbin; image_vbin = s.image_vbin;
+      image_hstart = s.image_hstart; image_hend = s.image_hend;
+      image_vstart = s.image_vstart; image_vend = s.image_vend;
+    }
+};
+
 class Camera{
   private:
     CameraWorker* owner;
+    AndorDriver* drv; // hardware or simulated camera
     bool initialized;
 
     int width;
@@ -33,33 +82,49 @@ class Camera{
     int tmax;
     float readouttime;
     bool using_kinetics;
+    bool using_streaming;
     unsigned int n_kinetics;
     unsigned int rows_kinetics;
+    int hbin; // horizontal binning
+    int vbin; // vertical binning
+    int readout_x; // first chip column read out
+    int readout_y; // first chip row read out, exposed area offset in kinetics
+    int readout_width; // image width after binning
+    int readout_height; // image height after binning, per image in kinetics
+    CameraSettings applied; // driver settings currently in effect
+    bool timings_valid; // timings match the applied settings
+    float timings[3]; // exposure, accumulate and kinetic cycle time in s
+    long circular_buffer; // images the driver buffers in run till abort mode
+    long next_image; // driver index of the next image to download when streaming
+    bool acquisition_signaled; // driver event of the current single shot fired
+
+    void fit_readout(const CameraExperimentControl& ctl);
 
   public:
-    Camera(CameraWorker* owner_);
+    // INDEX selects one of the connected cameras, see andor_available_cameras()
+    Camera(CameraWorker* owner_, bool simulate=false, int index=0);
     virtual ~Camera();
 
     bool Initialize();
     int GetTemperature();
-    bool SetupExperiment(float exposure_time,
-                         shutter_mode_t shutter_mode,
-                         bool internal_trigger,
-                         bool kinetics_mode,
-                         unsigned int number_kinetics
-                        );
+    bool ReadTelemetry(TelemetrySample& s);
+    bool SetupExperiment(const CameraExperimentControl& ctl);
     bool StartExperiment();
     int GetStatus();
-    bool DownloadImage(long** raw_image_data);
-    bool SaveLastImageTIFF(const std::string& path);
+    int WaitForAcquisition(int timeout_ms);
+    void CancelWait();
+    bool DownloadImage(Frame* frame);
+    int DownloadNextImage(Frame* frame, long& skipped);
     //bool SaveImageTIFF(const std::string& path, long** raw_image_data);
 
     bool AbortExperiment();
     void Shutdown();
     wxString GetVersionInformation();
 
+    bool IsStreaming() const {return using_streaming;}
     const int GetImageWidth() const {return width;}
     const int GetImageHeight() const {return height;}
+    // Full chip area, enough to hold any readout area and binning
     const int GetImageArea() const {return width*height;}
     const int GetImageBytes() const {return width*height*bitdepth/2;}
 };
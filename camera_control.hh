@@ -17,8 +17,7 @@
 
 #define ANDOR_CAMERA_TEMPERATURE -100
 #define ANDOR_DIRECTORY "c:\\Program Files\\Andor SOLIS"
-#define ANDOR_DRIVER_DIRECTORY ANDOR_DIRECTORY ## "\\Drivers"
-#define ANDOR_PALETTE ANDOR_DIRECTORY ## "\\GLOW.PAL"
+#define ANDOR_DRIVER_DIRECTORY ANDOR_DIRECTORY "\\Drivers"
 
 // Acquisition mode
 //   1 : single scan
@@ -54,17 +53,47 @@
 //   2 : external start (fast kinetics only)
 #define ANDOR_TRIGGER_MODE 1
 
-// horizontal and vertical binning in px
+// default horizontal and vertical binning in px
 #define ANDOR_HBIN 1
 #define ANDOR_VBIN 1
 
 // exposure time in s (float)
 #define ANDOR_EXPOSURE_TIME 0.001f
 
+// Maximum time in ms to block in WaitForAcquisition before checking
+// for user interrupts. Aborts also cancel the wait right away.
+#define ANDOR_WAIT_TIMEOUT_MS 500
+
+// Status poll period in ms when not using the blocking wait
+#define ANDOR_POLL_PERIOD_MS 50
+
+// Status poll period in ms between the acquisition event and the
+// driver reporting idle
+#define ANDOR_SETTLE_PERIOD_MS 1
+
+// Tries to fetch an image from the circular buffer while the driver
+// overwrites it
+#define ANDOR_DOWNLOAD_ATTEMPTS 3
+
 
 #define IMAGE_SPOOL_PATH "e:\\image_spool"
+
+#ifdef _WIN32
+#define PATH_SEPARATOR "\\"
+#else
+#define PATH_SEPARATOR "/"
+#endif
 #define IMAGE_NAME_FORMAT "%y%m%d-%H%M%S"
 
+// Spool files are named <run>_<image number>_<acquisition time>.tif,
+// with the run time stamp and the acquisition time in
+// IMAGE_NAME_FORMAT, the latter followed by -<milliseconds>
+#define IMAGE_NUMBER_DIGITS 6
+
+// An interval between two shots longer than this many trigger periods
+// counts as missed triggers
+#define TRIGGER_GAP_TOLERANCE 1.5
+
 typedef enum {AUTOMATIC,ALWAYS_OPEN,ALWAYS_CLOSED} shutter_mode_t;
 
 
@@ -73,22 +102,56 @@ class CameraExperimentControl{
     float exposure_time;
     shutter_mode_t shutter_mode;
     bool internal_trigger;
+    bool blocking_wait;
+    bool pipelined; // re-arm right after the download in single shot modes
+    bool streaming;
     bool kinetics_mode;
     bool process_kinetics;
     unsigned int number_kinetics;
     bool save_images;
     std::string image_spool_path;
+    float trigger_period; // expected time between triggers in ms, 0 if unknown
+
+    // Readout area in unbinned chip pixels, counted from 0. A width or
+    // height of 0 selects the full chip in that direction. In kinetics
+    // mode, the area applies to every kinetics image, and only its
+    // vertical extent is used.
+    int readout_x;
+    int readout_y;
+    int readout_width;
+    int readout_height;
+    unsigned int hbin;
+    unsigned int vbin;
+    bool lock_readout_to_roi; // follow the ROI selected in the image window
 
     CameraExperimentControl()
       : exposure_time(0.1f),
         shutter_mode(ALWAYS_OPEN),
         internal_trigger(true),
+        blocking_wait(true),
+        pipelined(true),
+        streaming(false),
         kinetics_mode(false),
         process_kinetics(false),
         number_kinetics(3),
         save_images(false),
-        image_spool_path(IMAGE_SPOOL_PATH)
+        image_spool_path(IMAGE_SPOOL_PATH),
+        trigger_period(0),
+        readout_x(0),
+        readout_y(0),
+        readout_width(0),
+        readout_height(0),
+        hbin(ANDOR_HBIN),
+        vbin(ANDOR_VBIN),
+        lock_readout_to_roi(false)
     {}
+
+    // Does C read out the same chip area with the same binning?
+    bool SameReadout(const CameraExperimentControl& c) const {
+      return readout_x == c.readout_x && readout_y == c.readout_y &&
+        readout_width == c.readout_width && readout_height == c.readout_height &&
+        hbin == c.hbin && vbin == c.vbin;
+    }
 };
 
 
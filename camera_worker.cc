@@ -11,37 +11,61 @@
 #include "gui_ids.hh"
 #include "camera.hh"
 #include "camera_worker.hh"
+#include "frame_ring.hh"
+#include "image_writer.hh"
+#include "tiff_writer.hh"
 
+#include "monotonic_clock.hh"
+
+#include <iomanip>
 #include <sstream>
 
 DEFINE_EVENT_TYPE(wxEVT_CAMERA_DATA)
 
 CameraWorker::CameraWorker(wxFrame* parent_,
                            message_queue_t* message_queue_,
-                           message_queue_t* command_queue_,
                            wxMutex* message_queue_mutex_,
-                           wxMutex* command_queue_mutex_,
-                           long** raw_picture_data_,
-                           wxMutex* raw_picture_data_mutex_,
+                           camera_channel_t* commands_,
+                           FrameRing* frame_ring_,
+                           ShotTimeline* timeline_,
+                           TelemetryRing* telemetry_,
                            CameraExperimentControl* experiment_control_,
-                           wxMutex* experiment_control_mutex_
+                           wxMutex* experiment_control_mutex_,
+                           bool simulate_camera,
+                           int camera_index_,
+                           const std::string& log_prefix_
                           )
   : parent(parent_),
     message_queue(message_queue_),
-    command_queue(command_queue_),
     message_queue_mutex(message_queue_mutex_),
-    command_queue_mutex(command_queue_mutex_),
-    raw_picture_data(raw_picture_data_),
-    raw_picture_data_mutex(raw_picture_data_mutex_),
+    commands(commands_),
+    frame_ring(frame_ring_),
+    timeline(timeline_),
+    telemetry(telemetry_),
     camera(NULL),
+    writer(NULL),
+    telemetry_worker(NULL),
     image_spool_path(IMAGE_SPOOL_PATH),
     experiment_control(experiment_control_),
     experiment_control_mutex(experiment_control_mutex_),
+    camera_index(camera_index_),
+    log_prefix(log_prefix_),
     save_images(false),
     using_kinetics(false),
-    n_kinetics(0)
+    n_kinetics(0),
+    blocking_wait(true),
+    pipelined(true),
+    readout_changed(false),
+    published_at_start(0),
+    saved_synchronously(0),
+    quit_requested(false),
+    trigger_period(0),
+    image_number(0),
+    images_missed(0),
+    last_acquired_ms(-1),
+    run_start_ms(0)
 {
-  camera = new Camera(this);
+  camera = new Camera(this,simulate_camera,camera_index);
 }
 
 CameraWorker::~CameraWorker(){
@@ -61,142 +85,103 @@ CameraWorker::~CameraWorker(){
     delete camera;
     camera = NULL;
   }
+  if(spare_frame.data){
+    delete[] spare_frame.data;
+    spare_frame.data = NULL;
+  }
 }
 
+// All events carry the camera index as extra long, so that the main
+// frame can tell the workers apart.
 void CameraWorker::signal_parent(int id, const std::string& msg){
   wxCommandEvent evt(wxEVT_COMMAND_MENU_SELECTED,id);
   if(msg!=""){
     evt.SetString(msg.c_str());
   }
+  evt.SetExtraLong(camera_index);
   wxPostEvent(parent,evt);
 }
 
 void* CameraWorker::Entry(){
   std::ostringstream os;
-  std::string cmd = "";
-  int i=0;
 
   log_message("Starting camera");
   if(!camera->Initialize()){
     log_error("Camera initialization failed");
     goto error;
   }
+  telemetry_worker = new TelemetryWorker(camera,telemetry);
+  if(telemetry_worker->Create() != wxTHREAD_NO_ERROR){
+    log_error("Cannot create telemetry thread");
+    delete telemetry_worker;
+    telemetry_worker = NULL;
+  }
+  else{
+    telemetry_worker->SetPriority(WXTHREAD_MIN_PRIORITY);
+    telemetry_worker->Run();
+  }
   log_message("Allocating image memory");
-  {
-    wxMutexLocker lock(*raw_picture_data_mutex);
-    int n = camera->GetImageArea();
-    *raw_picture_data = new long[n];
-    memset(*raw_picture_data,0,n*sizeof(long));
+  if(!frame_ring->Allocate(camera->GetImageArea())){
+    log_error("Failed allocating frame buffers");
+    goto error;
   }
-
-  while(true){
-    {
-      wxMutexLocker lock(*command_queue_mutex);
-      if(command_queue->size()){
-        cmd = command_queue->front();
-        command_queue->pop();
-      }
-    }
-    if(cmd != ""){
-      if(cmd == "QUIT"){
-        break;
-      }
-      else if(cmd == "TEMP?"){
-        int t = camera->GetTemperature();
-        wxCommandEvent evt = wxCommandEvent(wxEVT_CAMERA_DATA,ID_CAMERA_WORKER);
-        os << "TEMP:" << t << " C";
-        evt.SetString(os.str().c_str()); os.str("");
-        wxPostEvent(parent,evt);
-      }
-      else if(cmd == "START"){
-        if(!update_camera_control(true)){
-          goto error;
-        }
-        update_experiment_timestamp();
-        signal_experiment_begin();
-
-        // Continue taking pictures until aborted by user
-
-        bool aborted=false;
-        while(!aborted){ // aborted gets signaled in experiment loop
-          if(check_for_interrupt()){ // aborted.
-            break;
-          }
-
-          // Start experiment and wait for image
-          camera->StartExperiment();
-          while(!aborted){
-            i = camera->GetStatus();
-            if(i == 3){ // success!
-              //log_message("Acquisition successful");
-              break;
-            }
-            else if(i == 2) { // still acquiring
-              //log_message("Still acquiring");
-
-              // Check whether user aborted while camera is waiting
-              wxThread::Sleep(50);
-              aborted = check_for_interrupt();
-            }
-            else{ //something is wrong
-              log_error("Acquisition failed");
-              break;
-            }
-          } // end of wait for image loop
-          if(aborted){
-            break;
-          }
-
-
-          //log_message("Download raw image data from camera");
-          bool dlworked = false, saveworked=false;
-          std::string filestamp = get_timestamp_file();
-          std::string imgpath = get_timestamp_path(filestamp);
-          { // Download image data
-            wxMutexLocker lock(*raw_picture_data_mutex);
-            dlworked = camera->DownloadImage(raw_picture_data);
-            if(dlworked && save_images){
-              saveworked = camera->SaveLastImageTIFF(imgpath);
-            }
-          }
-          if(!dlworked){
-            log_error("Failed downloading image from camera");
-            break;
-          }
-
-          if(save_images){
-            if(saveworked){
-              os << "Image -> \"" << imgpath << "\"";
-              log_message(os.str()); os.str("");
-              signal_image_ready(using_kinetics?n_kinetics:1,imgpath);
-            }
-            else{
-              os << "Failed saving image to \"" << imgpath << "\"";
-              log_error(os.str()); os.str("");
-              break;
-            }
-          }
-          else{ // not saved to disk, but need to update image window
-            signal_image_ready(using_kinetics?n_kinetics:1);
-          }
-        } // end of experiment loop
-        signal_experiment_end();
-      }
-      else if(cmd == "INT:ABORT"){
-        log_message("ABORT futile, camera not running");
+  spare_frame.capacity = camera->GetImageArea();
+  spare_frame.data = new pixel_t[spare_frame.capacity];
+
+  writer = new ImageWriterWorker(this,frame_ring,timeline);
+  if(writer->Create() != wxTHREAD_NO_ERROR){
+    log_error("Cannot create image writer thread");
+    delete writer;
+    writer = NULL;
+    goto error;
+  }
+  writer->Run();
+
+  while(!quit_requested){
+    CameraCommand cmd;
+    commands->Receive(cmd);
+    switch(cmd.type){
+    case CAMERA_CMD_QUIT:
+      quit_requested = true;
+      break;
+    case CAMERA_CMD_START:
+      if(!update_camera_control(true) || !create_spool_directory()){
+        goto error;
       }
-      else if(cmd == "INT:CTL"){
-        log_message("CTL update handled on experiment start");
+      update_experiment_timestamp();
+      frame_ring->ResetCounters();
+      begin_numbering();
+      published_at_start = frame_ring->GetPublished();
+      timeline->Reset();
+      writer->ClearFailed();
+      saved_synchronously = 0;
+      signal_experiment_begin();
+
+      // Continue taking pictures until aborted by user
+      if(camera->IsStreaming()){
+        acquire_streaming();
       }
       else{
-        os << "Camera thread : do not know how to handle command \""
-           << cmd << "\"";
-        log_message(os.str()); os.str("");
+        acquire_single_shots();
       }
-      cmd = "";
-    }
-    else{
-      wxThread::Sleep(20);
+      // The file sorter cleans up once the experiment ended, so
+      // every image has to be on disk first.
+      writer->Flush();
+      log_frame_statistics();
+      log_timeline_statistics();
+      signal_experiment_end();
+      break;
+    case CAMERA_CMD_ABORT:
+      log_message("ABORT futile, camera not running");
+      break;
+    case CAMERA_CMD_CONTROL:
+      log_message("CTL update handled on experiment start");
+      break;
+    default:
+      os << "Camera thread : do not know how to handle command "
+         << cmd.type;
+      log_message(os.str()); os.str("");
+      break;
     }
   }
 
@@ -204,53 +189,293 @@ void* CameraWorker::Entry(){
 error:
   log_error("Fatal error, aborting camera thread.");
 exit:
+  if(telemetry_worker){
+    telemetry_worker->Quit();
+    telemetry_worker->Wait();
+    delete telemetry_worker;
+    telemetry_worker = NULL;
+  }
+  if(writer){
+    writer->Quit();
+    writer->Wait();
+    delete writer;
+    writer = NULL;
+  }
   return NULL;
 }
 
-// Check for interrupt commands on the command queue (indicated by
-// prefix INT:). If INT:ABORT, return true to signal stop. Otherwise
-// handle interrupt here and ignore every regular command.
-bool CameraWorker::check_for_interrupt(){
-  bool abortq = false;
-  { // Check for interrupts on the message queue
-    wxMutexLocker lock(*command_queue_mutex);
-    while(command_queue->size()){
-      std::string c = command_queue->front();
-      if(c == "QUIT"){
-        camera->AbortExperiment();
-        abortq = true;
+/*
+  Experiment loop for single scan and fast kinetics mode. Arm the
+  camera for every image, wait for the acquisition, download and save
+  it. In pipelined mode, the camera gets armed for the next shot right
+  after the download, so that publishing and saving the image overlap
+  the next exposure and trigger wait. Otherwise, the next shot is only
+  armed once the image is handed off. Returns when the user aborts or
+  something fails.
+ */
+void CameraWorker::acquire_single_shots(){
+  long shot = -1; // shot the camera is armed for, -1 if not armed
+  while(true){
+    if(shot < 0){
+      if(check_for_interrupt()){ // aborted.
         break;
       }
-      if(c.substr(0,4) == "INT:"){
-        c = c.substr(4);
-        if(c == "ABORT"){
-          camera->AbortExperiment();
-          abortq = true;
+      // Apply a new readout area between shots
+      if(readout_changed && !update_camera_control(true)){
+        break;
+      }
+      shot = timeline->Begin();
+      if(!camera->StartExperiment()){
+        shot = -1;
+        break;
+      }
+    }
+
+    double t_acquired = 0;
+    if(!wait_for_acquisition(shot,t_acquired)){
+      break;
+    }
+
+
+    //log_message("Download raw image data from camera");
+    // Download image data into a free frame slot. If the display
+    // and the image writer hold on to every slot, the frame is
+    // dropped for display but still downloaded and saved.
+    Frame* frame = frame_ring->BeginWrite();
+    Frame* target = frame;
+    if(!frame && save_images){
+      target = &spare_frame;
+    }
+    bool dlworked = true;
+    timeline->Stamp(shot,SHOT_DOWNLOAD_BEGIN);
+    if(target){
+      dlworked = camera->DownloadImage(target);
+    }
+    timeline->Stamp(shot,SHOT_DOWNLOAD_END);
+    if(!dlworked){
+      if(frame){
+        frame_ring->CancelWrite(frame);
+      }
+      log_error("Failed downloading image from camera");
+      break;
+    }
+
+    // The image is out of the driver, so the camera is free for the
+    // next shot, unless that needs a new readout area.
+    long done = shot;
+    bool stop = false;
+    shot = -1;
+    if(pipelined){
+      stop = check_for_interrupt();
+      if(!stop && !readout_changed){
+        shot = timeline->Begin();
+        if(!camera->StartExperiment()){
+          shot = -1;
+          stop = true; // hand off the image we have, then end
         }
-        else if(c == "CTL"){
-          update_camera_control(false);
+      }
+    }
+
+    number_frame(target,done,missed_triggers(t_acquired),t_acquired);
+    if(frame){
+      frame_ring->EndWrite(frame,save_images);
+    }
+    signal_image_ready(done,using_kinetics?n_kinetics:1);
+
+    if(save_images && !save_frame(target,frame!=NULL,done)){
+      break;
+    }
+    if(writer->HasFailed() || stop){
+      break;
+    }
+  } // end of experiment loop
+  if(shot >= 0){
+    camera->AbortExperiment();
+  }
+}
+
+/*
+  Wait until the camera is done with SHOT, either blocking in the
+  driver or by polling its status, and store the time in T_ACQUIRED.
+  Returns false if the user aborted or the acquisition failed.
+ */
+bool CameraWorker::wait_for_acquisition(long shot, double& t_acquired){
+  int i=0;
+  while(true){
+    if(blocking_wait){
+      i = camera->WaitForAcquisition(ANDOR_WAIT_TIMEOUT_MS);
+    }
+    else{
+      i = camera->GetStatus();
+    }
+    if(i == 3){ // success!
+      //log_message("Acquisition successful");
+      timeline->Stamp(shot,SHOT_ACQUIRED);
+      t_acquired = monotonic_ms();
+      return true;
+    }
+    else if(i == 2) { // still acquiring
+      //log_message("Still acquiring");
+
+      // Check whether user aborted while camera is waiting
+      if(!blocking_wait){
+        wxThread::Sleep(ANDOR_POLL_PERIOD_MS);
+      }
+      if(check_for_interrupt()){
+        return false;
+      }
+    }
+    else{ //something is wrong
+      log_error("Acquisition failed");
+      return false;
+    }
+  }
+}
+
+/*
+  Experiment loop for run till abort mode. Arm the camera once and
+  drain images from the driver's circular buffer as they arrive. The
+  camera keeps exposing while we download and save.
+ */
+void CameraWorker::acquire_streaming(){
+  int i=0;
+  bool failed=false;
+
+  // Every image gets its shot as soon as we start waiting for it
+  long shot = timeline->Begin();
+  if(!camera->StartExperiment()){
+    return;
+  }
+  while(!failed){
+    if(check_for_interrupt()){ // aborted.
+      break;
+    }
+    if(blocking_wait){
+      i = camera->WaitForAcquisition(ANDOR_WAIT_TIMEOUT_MS);
+      if(i == 3){
+        timeline->Stamp(shot,SHOT_ACQUIRED);
+      }
+      else if(i != 2){
+        log_error("Acquisition failed");
+        break;
+      }
+    }
+    else{
+      wxThread::Sleep(ANDOR_POLL_PERIOD_MS);
+    }
+
+    // Drain every image that has arrived. Images the display has no
+    // room for still need to be read out to make progress through the
+    // circular buffer, so they go to the spare frame.
+    while(true){
+      Frame* frame = frame_ring->BeginWrite();
+      Frame* target = frame ? frame : &spare_frame;
+      long skipped = 0;
+      timeline->Stamp(shot,SHOT_DOWNLOAD_BEGIN);
+      i = camera->DownloadNextImage(target,skipped);
+      if(i <= 0){
+        if(frame){
+          frame_ring->CancelWrite(frame);
         }
-        else{
-          log_message("Unhandled interrupt :\""+c+"\"");
+        if(i < 0){
+          log_error("Failed downloading image from camera");
+          failed = true;
         }
-        command_queue->pop();
+        break;
       }
-      else{
-        // ignore everything else
-        command_queue->pop();
+      timeline->Stamp(shot,SHOT_DOWNLOAD_END);
+      number_frame(target,shot,skipped,monotonic_ms());
+      if(frame){
+        frame_ring->EndWrite(frame,save_images);
+      }
+      signal_image_ready(shot,1);
+
+      if(save_images && !save_frame(target,frame!=NULL,shot)){
+        failed = true;
+        break;
+      }
+      if(writer->HasFailed()){
+        failed = true;
+        break;
+      }
+      shot = timeline->Begin();
+    }
+
+    // Re-arm with a new readout area. Images still in the circular
+    // buffer are lost.
+    if(!failed && readout_changed){
+      camera->AbortExperiment();
+      if(!update_camera_control(true) || !camera->StartExperiment()){
+        break;
       }
     }
   }
-  return abortq;
+  camera->AbortExperiment();
 }
 
-void CameraWorker::clear_command_queue(){
-  { // clear command queue
-    wxMutexLocker lock(*command_queue_mutex);
-    while(!command_queue->empty()){
-      command_queue->pop();
+/*
+  Save a downloaded frame under a new time stamped name. Frames
+  published to the ring with a reference held go to the image writer.
+  Frames that did not get a slot are written right away, so
+  acquisition only waits for the disk when the writer falls behind.
+  Returns false if a synchronous write failed.
+ */
+bool CameraWorker::save_frame(Frame* frame, bool held, long shot){
+  std::string imgpath = get_image_path(*frame);
+  if(held){
+    writer->Write(frame,imgpath,shot);
+    return true;
+  }
+
+  std::ostringstream os;
+  ++saved_synchronously;
+  timeline->Stamp(shot,SHOT_SAVE_BEGIN);
+  bool ok = write_frame_tiff(imgpath,*frame);
+  timeline->Stamp(shot,SHOT_SAVE_END);
+  if(!ok){
+    os << "Failed saving image to \"" << imgpath << "\"";
+    log_error(os.str());
+    return false;
+  }
+  os << "Image -> \"" << imgpath << "\"";
+  log_message(os.str());
+  signal_image_saved(frame->n_images,imgpath);
+  return true;
+}
+
+// Handle urgent commands while the experiment runs. Return true if
+// the experiment has to stop, because of ABORT or QUIT. Regular
+// commands are ignored until the experiment ends.
+bool CameraWorker::check_for_interrupt(){
+  bool abortq = false;
+  CameraCommand c;
+  while(commands->ReceiveUrgent(c)){
+    switch(c.type){
+    case CAMERA_CMD_QUIT:
+      quit_requested = true;
+      // fall through
+    case CAMERA_CMD_ABORT:
+      camera->AbortExperiment();
+      abortq = true;
+      break;
+    case CAMERA_CMD_CONTROL:
+      update_camera_control(false);
+      break;
+    default:
+      {
+        std::ostringstream os;
+        os << "Unhandled interrupt : " << c.type;
+        log_message(os.str());
+      }
+      break;
     }
   }
+  commands->DiscardRegular();
+  return abortq;
+}
+
+void CameraWorker::clear_command_queue(){
+  commands->Clear();
 }
 
 // Update internal variables from CameraExperimentControl. If
@@ -262,16 +487,19 @@ bool CameraWorker::update_camera_control(bool setup_experiment){
     wxMutexLocker lock(*experiment_control_mutex);
     if(setup_experiment){
       using_kinetics = experiment_control->kinetics_mode;
+      blocking_wait = experiment_control->blocking_wait;
+      pipelined = experiment_control->pipelined;
       n_kinetics = experiment_control->number_kinetics;
-      rc = camera->SetupExperiment(experiment_control->exposure_time,
-                                   experiment_control->shutter_mode,
-                                   experiment_control->internal_trigger,
-                                   experiment_control->kinetics_mode,
-                                   experiment_control->number_kinetics
-                                  );
+      rc = camera->SetupExperiment(*experiment_control);
       if(!rc) {
         log_error("Camera Experiment Setup failed");
       }
+      applied_readout = *experiment_control;
+      readout_changed = false;
+    }
+    else if(!readout_changed && !experiment_control->SameReadout(applied_readout)){
+      log_message("Readout area changed, setting up camera again");
+      readout_changed = true;
     }
     if(rc){
       if(save_images != experiment_control->save_images){
@@ -288,6 +516,7 @@ bool CameraWorker::update_camera_control(bool setup_experiment){
       }
       save_images = experiment_control->save_images;
       image_spool_path = experiment_control->image_spool_path.c_str();
+      trigger_period = experiment_control->trigger_period;
     }
   }
   return rc;
@@ -298,7 +527,7 @@ bool CameraWorker::update_camera_control(bool setup_experiment){
 void CameraWorker::log_message(const std::string& msg){
   {
     wxMutexLocker lock(*message_queue_mutex);
-    message_queue->push(msg);
+    message_queue->push(log_prefix+msg);
   }
   signal_parent(ID_NEW_CHILD_MESSAGE);
 }
@@ -306,38 +535,140 @@ void CameraWorker::log_message(const std::string& msg){
 void CameraWorker::log_error(const std::string& msg){
   {
     wxMutexLocker lock(*message_queue_mutex);
-    message_queue->push(msg);
+    message_queue->push(log_prefix+msg);
   }
   signal_parent(ID_NEW_CHILD_ERROR);
 }
 
+void CameraWorker::log_frame_statistics(){
+  std::ostringstream os;
+  os << "Frames published: " << frame_ring->GetPublished()-published_at_start
+     << ", dropped: " << frame_ring->GetDropped()
+     << ", overwritten before display: " << frame_ring->GetOverwritten()
+     << ", skipped for display: " << frame_ring->GetSkipped()
+     << ", images numbered: " << image_number
+     << ", missed by the camera: " << images_missed;
+  if(saved_synchronously){
+    os << ", saved without the image writer: " << saved_synchronously;
+  }
+  log_message(os.str());
+}
+
+void CameraWorker::log_timeline_statistics(){
+  std::vector<StageStatistics> stats;
+  timeline->GetStatistics(stats,SHOT_TIMELINE_RECORDS);
+  if(stats[SHOT_STAGES].n == 0){
+    return;
+  }
+  std::ostringstream os;
+  os << "Shot timeline (" << (blocking_wait?"blocking wait":"polling")
+     << ") over " << stats[SHOT_STAGES].n << " shots, p50/p99/max in ms: "
+     << timeline->FormatStatistics(SHOT_TIMELINE_RECORDS);
+  log_message(os.str());
+}
+
+// Tell the GUI that the N_IMAGES sub images of PATH are on disk, so
+// that it can hand them to the file sorter. Called from the camera
+// and the image writer thread.
+void CameraWorker::signal_image_saved(size_t n_images, const std::string& path){
+  wxCommandEvent evt(wxEVT_COMMAND_MENU_SELECTED,ID_CAMERA_IMAGE_SAVED);
+  evt.SetString(path.c_str());
+  evt.SetInt((int)n_images);
+  evt.SetExtraLong(camera_index);
+  wxPostEvent(parent,evt);
+}
+
+// Cancel a blocking wait for the camera so that commands dispatched
+// from the GUI thread get handled immediately. Called from the GUI
+// thread.
+void CameraWorker::InterruptWait(){
+  if(camera){
+    camera->CancelWait();
+  }
+}
+
 void CameraWorker::signal_experiment_begin(){
   signal_parent(ID_CAMERA_EXPERIMENT_BEGIN,experiment_timestamp.c_str());
 }
 
 void CameraWorker::signal_experiment_end(){
   std::ostringstream os;
-  os << image_spool_path << "\\" << experiment_timestamp << "_*.tif_*";
+  os << image_spool_path << PATH_SEPARATOR << experiment_timestamp << "_*.tif_*";
   signal_parent(ID_CAMERA_EXPERIMENT_END,os.str());
 }
 
-void CameraWorker::signal_image_ready(size_t n_images, const std::string& locator){
+// The event carries SHOT as its integer. If the GUI has not handled
+// the previous event yet, it will pick up the newest frame anyway, so
+// no further event is posted, see FrameRing::ClaimNotify().
+void CameraWorker::signal_image_ready(long shot, size_t n_images){
+  timeline->Stamp(shot,SHOT_POSTED);
+  if(!frame_ring->ClaimNotify()){
+    return;
+  }
   std::ostringstream os;
-  os << locator << ";" << n_images;
-  signal_parent(ID_CAMERA_IMAGE_READY,os.str());
+  os << ";" << n_images;
+  wxCommandEvent evt(wxEVT_COMMAND_MENU_SELECTED,ID_CAMERA_IMAGE_READY);
+  evt.SetString(os.str().c_str());
+  evt.SetInt((int)shot);
+  evt.SetExtraLong(camera_index);
+  wxPostEvent(parent,evt);
 }
 
-std::string CameraWorker::get_timestamp_file(){
+// Spool file name of FRAME, see IMAGE_NUMBER_DIGITS. The acquisition
+// time is the wall clock at the start of the run plus the monotonic
+// time since, which resolves milliseconds unlike the system clock.
+std::string CameraWorker::get_image_path(const Frame& frame){
+  wxDateTime t = run_start +
+    wxTimeSpan::Milliseconds((long)(frame.timestamp - run_start_ms + 0.5));
   std::ostringstream os;
-  os << IMAGE_NAME_FORMAT << ".tif";
-  return wxDateTime::Now().Format(os.str().c_str()).c_str();
+  os << image_spool_path << PATH_SEPARATOR << experiment_timestamp << "_"
+     << std::setfill('0') << std::setw(IMAGE_NUMBER_DIGITS) << frame.number << "_"
+     << t.Format(IMAGE_NAME_FORMAT).c_str() << "-" << std::setw(3) << t.GetMillisecond()
+     << ".tif";
+  return os.str();
 }
 
-std::string CameraWorker::get_timestamp_path(const std::string& timestamp_file){
-  std::ostringstream os;
-  os << image_spool_path << "\\" << experiment_timestamp << "_"
-     << timestamp_file;
-  return os.str().c_str();
+// Restart image numbers and acquisition times for a new run
+void CameraWorker::begin_numbering(){
+  image_number = 0;
+  images_missed = 0;
+  last_acquired_ms = -1;
+  run_start = wxDateTime::UNow();
+  run_start_ms = monotonic_ms();
+}
+
+// Number of triggers that must have come and gone while the camera
+// was not armed, judging from the time since the previous image. Needs
+// the trigger period.
+long CameraWorker::missed_triggers(double t_acquired){
+  if(trigger_period <= 0 || last_acquired_ms < 0){
+    return 0;
+  }
+  double periods = (t_acquired - last_acquired_ms) / trigger_period;
+  if(periods < TRIGGER_GAP_TOLERANCE){
+    return 0;
+  }
+  return (long)(periods + 0.5) - 1;
+}
+
+// Give FRAME the next image number after skipping MISSED numbers, its
+// SHOT and the acquisition time T_ACQUIRED. FRAME may be NULL if the
+// image was not downloaded, it still uses up its number.
+void CameraWorker::number_frame(Frame* frame, long shot, long missed, double t_acquired){
+  if(missed > 0){
+    std::ostringstream os;
+    os << "Missed " << missed << " image(s) before image " << image_number + missed;
+    log_error(os.str());
+    images_missed += missed;
+    image_number += missed;
+  }
+  if(frame){
+    frame->number = image_number;
+    frame->timestamp = t_acquired;
+    frame->shot = shot;
+  }
+  ++image_number;
+  last_acquired_ms = t_acquired;
 }
 
 void CameraWorker::update_experiment_timestamp(){
@@ -345,5 +676,17 @@ void CameraWorker::update_experiment_timestamp(){
   //wxMkdir(image_spool_path + "\\" + experiment_timestamp);
 }
 
+// Every camera spools into its own directory, which the main frame
+// may have made up, so create it if necessary.
+bool CameraWorker::create_spool_directory(){
+  if(wxDirExists(image_spool_path) || wxMkdir(image_spool_path)){
+    return true;
+  }
+  std::ostringstream os;
+  os << "Failed creating spool directory \"" << image_spool_path << "\"";
+  log_error(os.str());
+  return false;
+}
+
 
 // camera_worker.cc ends here
@@ -14,65 +14,132 @@
 
 #define SHUTDOWN_DELAY 5
 
+// Maximum number of queued commands per priority
+#define CAMERA_COMMAND_CAPACITY 64
+
 #include <wx/wx.h>
 #include <wx/thread.h>
 #include <queue>
 #include <string>
+#include <vector>
+
+#include "command_channel.hh"
+#include "frame_ring.hh"
+#include "shot_timeline.hh"
+#include "telemetry.hh"
+#include "camera_control.hh"
 
 typedef std::queue<std::string> message_queue_t;
+
+enum CameraCommandType {
+  CAMERA_CMD_QUIT,
+  CAMERA_CMD_START, // set up and run the experiment until aborted
+  CAMERA_CMD_ABORT, // stop the experiment
+  CAMERA_CMD_CONTROL // experiment control changed
+};
+
+class CameraCommand {
+  public:
+    CameraCommandType type;
+
+    CameraCommand(CameraCommandType type_=CAMERA_CMD_QUIT) : type(type_) {}
+    // Urgent commands interrupt a running experiment.
+    bool IsUrgent() const {
+      return type == CAMERA_CMD_QUIT || type == CAMERA_CMD_ABORT ||
+        type == CAMERA_CMD_CONTROL;
+    }
+};
+
+typedef CommandChannel<CameraCommand> camera_channel_t;
+
 class Camera;
-class CameraExperimentControl;
+class ImageWriterWorker;
 class CameraWorker : public wxThread {
   private:
     wxFrame* parent;
     message_queue_t* message_queue;
-    message_queue_t* command_queue;
     wxMutex* message_queue_mutex;
-    wxMutex* command_queue_mutex;
-    long** raw_picture_data;
-    wxMutex* raw_picture_data_mutex;
+    camera_channel_t* commands;
+    FrameRing* frame_ring;
+    ShotTimeline* timeline;
+    TelemetryRing* telemetry;
+    Frame spare_frame; // drain target when all frame slots are busy
     Camera* camera;
+    ImageWriterWorker* writer;
+    TelemetryWorker* telemetry_worker;
     wxString image_spool_path;
     CameraExperimentControl* experiment_control;
     wxMutex* experiment_control_mutex;
     wxString experiment_timestamp;
+    int camera_index; // tags every event posted to the parent
+    std::string log_prefix;
 
     bool save_images;
     bool using_kinetics;
     size_t n_kinetics;
+    bool blocking_wait;
+    bool pipelined; // arm the next shot before handing off the last image
+    CameraExperimentControl applied_readout; // readout area the camera is set up for
+    bool readout_changed; // readout area changed while running
+    long published_at_start;
+    long saved_synchronously; // images the writer had no room for
+    bool quit_requested; // QUIT arrived during the experiment
+    float trigger_period; // expected time between triggers in ms, 0 if unknown
+    long image_number; // number of the next image in the run
+    long images_missed; // numbers skipped for images the camera missed
+    double last_acquired_ms; // acquisition time of the previous image, -1 if none
+    wxDateTime run_start; // wall clock at the start of the run
+    double run_start_ms; // monotonic_ms() at the start of the run
 
     CameraWorker(CameraWorker&){}
     void signal_parent(int id, const std::string& msg="");
 
-    std::string get_timestamp_file();
-    std::string get_timestamp_path(const std::string& timestamp_file);
+    void acquire_single_shots();
+    bool wait_for_acquisition(long shot, double& t_acquired);
+    void acquire_streaming();
+    bool save_frame(Frame* frame, bool held, long shot);
+    void begin_numbering();
+    long missed_triggers(double t_acquired);
+    void number_frame(Frame* frame, long shot, long missed, double t_acquired);
+
+    std::string get_image_path(const Frame& frame);
 
   public:
     CameraWorker(wxFrame* parent_,
                  message_queue_t* message_queue_,
-                 message_queue_t* command_queue_,
                  wxMutex* message_queue_mutex_,
-                 wxMutex* command_queue_mutex_,
-                 long** raw_picture_data,
-                 wxMutex* raw_picture_data_mutex_,
+                 camera_channel_t* commands_,
+                 FrameRing* frame_ring_,
+                 ShotTimeline* timeline_,
+                 TelemetryRing* telemetry_,
                  CameraExperimentControl* experiment_control_,
-                 wxMutex* experiment_control_mutex_
+                 wxMutex* experiment_control_mutex_,
+                 bool simulate_camera=false,
+                 int camera_index_=0,
+                 const std::string& log_prefix_=""
                 );
     ~CameraWorker();
 
     virtual void* Entry();
 
+    int GetCameraIndex() const {return camera_index;}
+
     void log_message(const std::string& msg);
     void log_error(const std::string& msg);
 
+    void log_frame_statistics();
+    void log_timeline_statistics();
     void signal_experiment_begin();
     void signal_experiment_end();
-    void signal_image_ready(size_t n_images, const std::string& locator="");
+    void signal_image_ready(long shot, size_t n_images);
+    void signal_image_saved(size_t n_images, const std::string& path);
 
+    void InterruptWait();
     bool check_for_interrupt();
     void clear_command_queue();
     bool update_camera_control(bool setup_experiment);
     void update_experiment_timestamp();
+    bool create_spool_directory();
 
 };
 
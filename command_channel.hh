@@ -0,0 +1,117 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 17:32:19 sb"
+
+/*
+  file       command_channel.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef COMMAND_CHANNEL_HH
+#define COMMAND_CHANNEL_HH
+
+#include <wx/thread.h>
+#include <deque>
+
+#include "monotonic_clock.hh"
+
+/*
+  Bounded channel that hands typed commands from any thread to one
+  worker thread. The worker blocks in Receive() until a command
+  arrives instead of polling. Commands for which T::IsUrgent() holds
+  go to a separate lane that is always served first, so that an abort
+  overtakes queued work. Each lane holds at most CAPACITY commands,
+  beyond that Post() fails instead of growing without limit.
+ */
+template<typename T>
+class CommandChannel {
+  private:
+    wxMutex mutex; // protects both lanes
+    wxCondition condition; // signaled when a command arrives
+    std::deque<T> regular;
+    std::deque<T> urgent;
+    size_t capacity;
+
+    CommandChannel(const CommandChannel&) : condition(mutex) {}
+
+    // Pop the next command, urgent ones first. Needs the mutex.
+    bool pop(T& cmd){
+      std::deque<T>& lane = urgent.empty() ? regular : urgent;
+      if(lane.empty()){
+        return false;
+      }
+      cmd = lane.front();
+      lane.pop_front();
+      return true;
+    }
+
+  public:
+    CommandChannel(size_t capacity_)
+      : condition(mutex), capacity(capacity_)
+    {}
+
+    // Queue CMD and wake up the worker. Returns false if its lane is
+    // full.
+    bool Post(const T& cmd){
+      wxMutexLocker lock(mutex);
+      std::deque<T>& lane = cmd.IsUrgent() ? urgent : regular;
+      if(lane.size() >= capacity){
+        return false;
+      }
+      lane.push_back(cmd);
+      condition.Signal();
+      return true;
+    }
+
+    // Wait for the next command at most TIMEOUT_MS, or forever if
+    // TIMEOUT_MS is negative. Returns false on timeout.
+    bool Receive(T& cmd, long timeout_ms=-1){
+      wxMutexLocker lock(mutex);
+      double deadline = monotonic_ms() + timeout_ms;
+      while(!pop(cmd)){
+        if(timeout_ms < 0){
+          condition.Wait();
+        }
+        else{
+          double left = deadline - monotonic_ms();
+          if(left <= 0){
+            return false;
+          }
+          condition.WaitTimeout((unsigned long)left + 1);
+        }
+      }
+      return true;
+    }
+
+    // Take the next urgent command without waiting. Returns false if
+    // there is none.
+    bool ReceiveUrgent(T& cmd){
+      wxMutexLocker lock(mutex);
+      if(urgent.empty()){
+        return false;
+      }
+      cmd = urgent.front();
+      urgent.pop_front();
+      return true;
+    }
+
+    // Drop all regular commands and return how many there were.
+    size_t DiscardRegular(){
+      wxMutexLocker lock(mutex);
+      size_t n = regular.size();
+      regular.clear();
+      return n;
+    }
+
+    void Clear(){
+      wxMutexLocker lock(mutex);
+      regular.clear();
+      urgent.clear();
+    }
+};
+
+
+#endif // COMMAND_CHANNEL_HH
+
+// command_channel.hh ends here
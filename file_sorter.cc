@@ -10,6 +10,7 @@
 
 #include "gui_ids.hh"
 #include "file_sorter.hh"
+#include "camera_control.hh"
 #include <sstream>
 #include <wx/filename.h>
 #include <wx/file.h>
@@ -20,15 +21,13 @@ DEFINE_EVENT_TYPE(wxEVT_FILE_SORTER)
 FileSorterWorker::FileSorterWorker(wxFrame* parent_,
                                    message_queue_t* message_queue_,
                                    wxMutex* message_queue_mutex_,
-                                   message_queue_t* command_queue_,
-                                   wxMutex* command_queue_mutex_,
+                                   file_sorter_channel_t* commands_,
                                    const std::string target_directory_
                                   )
 : parent(parent_),
   message_queue(message_queue_),
   message_queue_mutex(message_queue_mutex_),
-  command_queue(command_queue_),
-  command_queue_mutex(command_queue_mutex_),
+  commands(commands_),
   target_directory(target_directory_)
 {
 }
@@ -60,134 +59,129 @@ void FileSorterWorker::log_error(const std::string& msg){
 
 void* FileSorterWorker::Entry(){
   std::ostringstream os;
-  std::string cmd;
+  FileSorterCommand cmd;
   wxFile f1, f2;
   wxFileOffset l;
   void* buf = NULL;
 
   log_message("Starting file sorter");
   while(true){
-    {
-      wxMutexLocker lock(*command_queue_mutex);
-      if(command_queue->size()){
-        cmd = command_queue->front();
-        command_queue->pop();
+    commands->Receive(cmd);
+    if(cmd.type == FILE_SORTER_CMD_QUIT){
+      break;
+    }
+    else if(cmd.type == FILE_SORTER_CMD_CLEANUP){
+      wxFileName f(cmd.path.c_str());
+      wxString dir = f.GetPath();
+      wxString glob = f.GetName()+f.GetExt();
+      wxArrayString files;
+      size_t n = wxDir::GetAllFiles(dir,&files,glob,wxDIR_FILES);
+      log_message(std::string("Cleanup: \"")+cmd.path+"\"");
+      for(size_t i=0; i<n; ++i){
+        if(!wxRemoveFile(files[i])){
+          os << "Failed removing file \"" << files[i] << "\"";
+          goto error;
+        }
       }
     }
-    if(cmd != ""){
-      if(cmd == "QUIT"){
-        break;
+    else if(cmd.type == FILE_SORTER_CMD_SORT){
+      wxString c = cmd.path.c_str();
+      unsigned long frames = cmd.n_images;
+      size_t i=0;
+
+      // Spool names are <run>_<image number>_<acquisition time>, see
+      // CameraWorker::get_image_path(). Sorted files are named
+      // <image number>_<time of day>_<sub image>, so that they list
+      // in acquisition order.
+      wxFileName f(c);
+      wxString n = f.GetName();
+      wxString run = n.Mid(7,6);
+      wxString number = n.AfterFirst('_').BeforeFirst('_');
+      wxString file = number + "_" + n.AfterLast('_').Mid(7);
+      wxString dirdate = target_directory + PATH_SEPARATOR + n.Mid(0,6);
+      wxString rundir = dirdate + PATH_SEPARATOR + run;
+      wxString camdir = rundir;
+      if(cmd.camera > 0){
+        camdir = rundir + PATH_SEPARATOR + wxString::Format("cam%d",cmd.camera);
+      }
+      wxString infile = c + "_%d";
+      wxString tofile = camdir + PATH_SEPARATOR + file + "_%d." + f.GetExt();
+
+      if(!wxDirExists(target_directory.c_str())){
+        os << "Base directory \"" << target_directory << "\" does not exist";
+        goto error;
       }
-      else if(cmd.substr(0,8) == "CLEANUP:"){
-        cmd = cmd.substr(8);
-        wxFileName f(cmd.c_str());
-        wxString dir = f.GetPath();
-        wxString glob = f.GetName()+f.GetExt();
-        wxArrayString files;
-        size_t n = wxDir::GetAllFiles(dir,&files,glob,wxDIR_FILES);
-        log_message(std::string("Cleanup: \"")+cmd+"\"");
-        for(size_t i=0; i<n; ++i){
-          if(!wxRemoveFile(files[i])){
-            os << "Failed removing file \"" << files[i] << "\"";
-            goto error;
-          }
+      if(!wxDirExists(dirdate)){
+        if(!wxMkdir(dirdate)){
+          os << "Failed creating directory \"" << dirdate.c_str() << "\"";
+          goto error;
+        }
+      }
+      if(!wxDirExists(rundir)){
+        if(!wxMkdir(rundir)){
+          os << "Failed creating directory \"" << rundir.c_str() << "\"";
+          goto error;
         }
       }
-      else if(cmd.substr(0,5) == "SORT:"){
-        wxString c = cmd.substr(5);
-        unsigned long frames = 1;
-        int p = c.Find(';',true);
-        //os << "sort:\"" << c << "\", p=" << p;
-        //log_message(os.str()); os.str("");
-        size_t i=0;
-        if(p != wxNOT_FOUND){
-          if(!c.Mid(p+1).ToULong(&frames)){
-            frames = 1;
-          }
-          c = c.Mid(0,p);
+      if(!wxDirExists(camdir)){
+        if(!wxMkdir(camdir)){
+          os << "Failed creating directory \"" << camdir.c_str() << "\"";
+          goto error;
         }
+      }
+
+      /* Do not use wxCopyFile or Win32::CopyFile since these work
+         asynchronously and fail when copying many large files over
+         the network. Instead do the naive thing and copy by hand.
+      */
 
-        wxFileName f(c);
-        wxString n = f.GetName();
-        wxString run = n.Mid(7,6);
-        wxString file = n.Mid(21,6);
-        wxString dirdate = target_directory + "\\" + n.Mid(0,6);
-        wxString rundir = dirdate + "\\" + run;
-        wxString infile = c + "_%d";
-        wxString tofile = rundir+"\\" + file + "_%d." + f.GetExt();
-
-        if(!wxDirExists(target_directory.c_str())){
-          os << "Base directory \"" << target_directory << "\" does not exist";
+      for(i=0; i<frames; ++i){
+        if(!f1.Open(wxString::Format(infile,i),wxFile::read)){
+          os << "Failed opening \"" << wxString::Format(infile,i).c_str()
+             << "\" for reading";
           goto error;
         }
-        if(!wxDirExists(dirdate)){
-          if(!wxMkdir(dirdate)){
-            os << "Failed creating directory \"" << dirdate.c_str() << "\"";
-            goto error;
-          }
+        l = f1.Length();
+        if(!f2.Open(wxString::Format(tofile,i),wxFile::write)){
+          os << "Failed opening \"" << wxString::Format(tofile,i).c_str()
+             << "\" for writing";
+          goto error;
         }
-        if(!wxDirExists(rundir)){
-          if(!wxMkdir(rundir)){
-            os << "Failed creating directory \"" << rundir.c_str() << "\"";
-            goto error;
-          }
+        buf = (void*)malloc(sizeof(char)*l);
+        if(f1.Read(buf,l)!=l){
+          os << "Failed reading complete file \""
+             << wxString::Format(infile,i).c_str() << "\"";
+          goto error;
         }
-
-        /* Do not use wxCopyFile or Win32::CopyFile since these work
-           asynchronously and fail when copying many large files over
-           the network. Instead do the naive thing and copy by hand.
-        */
-
-        for(i=0; i<frames; ++i){
-          if(!f1.Open(wxString::Format(infile,i),wxFile::read)){
-            os << "Failed opening \"" << wxString::Format(infile,i).c_str()
-               << "\" for reading";
-            goto error;
-          }
-          l = f1.Length();
-          if(!f2.Open(wxString::Format(tofile,i),wxFile::write)){
-            os << "Failed opening \"" << wxString::Format(tofile,i).c_str()
-               << "\" for writing";
-            goto error;
-          }
-          buf = (void*)malloc(sizeof(char)*l);
-          if(f1.Read(buf,l)!=l){
-            os << "Failed reading complete file \""
-               << wxString::Format(infile,i).c_str() << "\"";
-            goto error;
-          }
-          f1.Close();
-          if(f2.Write(buf,l)!=l){
-            os << "Failed writing complete file \""
-               << wxString::Format(tofile,i).c_str() << "\"";
-            goto error;
-          }
-          free(buf); buf = NULL;
-          f2.Close();
+        f1.Close();
+        if(f2.Write(buf,l)!=l){
+          os << "Failed writing complete file \""
+             << wxString::Format(tofile,i).c_str() << "\"";
+          goto error;
         }
+        free(buf); buf = NULL;
+        f2.Close();
+      }
 
-        /* Another cache problem. When calling wxRemoveFile here, the
-           file disappears too fast for some of the copying above.
+      /* Another cache problem. When calling wxRemoveFile here, the
+         file disappears too fast for some of the copying above.
 
-           if(!wxRemoveFile(c)){
-             os << "Failed removing \"" << c << "\""; goto error;
-           }
+         if(!wxRemoveFile(c)){
+           os << "Failed removing \"" << c << "\""; goto error;
+         }
 
-           Instead, implemented cleanup action when a run is done and
-           sorted completely.
-        */
+         Instead, implemented cleanup action when a run is done and
+         sorted completely.
+      */
 
-        os << "Sort: \"" <<  infile << "\" \"" << tofile << "\", "
-           << frames << " frames";
-        log_message(os.str()); os.str("");
+      os << "Sort: \"" <<  infile << "\" \"" << tofile << "\", "
+         << frames << " frames";
+      log_message(os.str()); os.str("");
 //         os << "dirdate: \"" << dirdate << "\"";
 //         log_message(os.str()); os.str("");
 //         os << "rundir: \"" << rundir << "\"";
 //         log_message(os.str()); os.str("");
-      }
     }
-    cmd = "";
-    wxThread::Sleep(100);
   }
   goto exit;
 error:
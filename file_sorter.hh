@@ -16,14 +16,45 @@
 #include <queue>
 #include <string>
 
+#include "command_channel.hh"
+
+// Maximum number of queued commands. Sorting can fall behind the
+// camera when the network is slow, so leave plenty of room.
+#define FILE_SORTER_COMMAND_CAPACITY 4096
+
 typedef std::queue<std::string> message_queue_t;
+
+enum FileSorterCommandType {
+  FILE_SORTER_CMD_QUIT,
+  FILE_SORTER_CMD_SORT, // copy the images of PATH to the target directory
+  FILE_SORTER_CMD_CLEANUP // remove the spool files matching the glob PATH
+};
+
+class FileSorterCommand {
+  public:
+    FileSorterCommandType type;
+    std::string path;
+    unsigned long n_images; // number of kinetics images for SORT
+    int camera; // images of camera k > 0 go to the cam<k> subdirectory of the run
+
+    FileSorterCommand(FileSorterCommandType type_=FILE_SORTER_CMD_QUIT,
+                      const std::string& path_="", unsigned long n_images_=1,
+                      int camera_=0)
+      : type(type_), path(path_), n_images(n_images_), camera(camera_)
+    {}
+    // Commands are handled strictly in order, so that QUIT and
+    // CLEANUP wait for pending sorts.
+    bool IsUrgent() const {return false;}
+};
+
+typedef CommandChannel<FileSorterCommand> file_sorter_channel_t;
+
 class FileSorterWorker : public wxThread{
   private:
     wxFrame* parent;
     message_queue_t* message_queue;
     wxMutex* message_queue_mutex;
-    message_queue_t* command_queue;
-    wxMutex* command_queue_mutex;
+    file_sorter_channel_t* commands;
     std::string target_directory;
 
     FileSorterWorker(FileSorterWorker&) {}
@@ -32,8 +63,7 @@ class FileSorterWorker : public wxThread{
     FileSorterWorker(wxFrame* parent_,
                      message_queue_t* message_queue_,
                      wxMutex* message_queue_mutex_,
-                     message_queue_t* command_queue_,
-                     wxMutex* command_queue_mutex_,
+                     file_sorter_channel_t* commands_,
                      const std::string target_directory_
                     );
     ~FileSorterWorker();
@@ -0,0 +1,662 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-18 04:47:03 sb"
+
+/*
+  file       frame_processor.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "frame_processor.hh"
+#include "gui_ids.hh"
+#include "image_window.hh"
+#include "od_kernels.hh"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+
+/*
+  Band tasks for FrameProcessor::process_data(), see BandPool. Each task
+  processes a range of image rows.
+ */
+
+// Color the rows of PALROI, leaving the rest of the RGB image alone.
+// Band rows count from the top of PALROI. Find the minimum and
+// maximum of PALROI on the way.
+template <typename T>
+class InterpolateTask : public BandTask {
+  private:
+    const T* t;
+    unsigned char* rgb;
+    const PaletteTable* pal;
+    size_t width;
+    wxRect palroi;
+  public:
+    std::vector<float> band_min;
+    std::vector<float> band_max;
+
+    InterpolateTask(const T* t_, unsigned char* rgb_, const PaletteTable* pal_,
+                    size_t width_, const wxRect& palroi_, size_t n_bands)
+      : t(t_), rgb(rgb_), pal(pal_), width(width_), palroi(palroi_),
+        band_min(n_bands,FLT_MAX), band_max(n_bands,-FLT_MAX)
+    {}
+    void Run(size_t band, size_t row0, size_t row1){
+      size_t j0 = palroi.y + row0;
+      size_t j1 = palroi.y + row1;
+      size_t idx = 0;
+      float v = 0, tmin = FLT_MAX, tmax = -FLT_MAX;
+      const unsigned char* c = NULL;
+      for(size_t j=j0; j<j1; ++j){
+        for(int i=0; i<palroi.width; ++i){
+          idx = j*width + (palroi.x+i);
+          v = (float)t[idx];
+          if(v < tmin){ tmin = v; }
+          if(v > tmax){ tmax = v; }
+          c = pal->Lookup(v);
+          rgb[3*idx] = c[0]; rgb[3*idx+1] = c[1]; rgb[3*idx+2] = c[2];
+        }
+      }
+      band_min[band] = tmin;
+      band_max[band] = tmax;
+    }
+};
+
+/*
+  Single pass over the rows of a frame. For kinetics frames, calculate
+  the OD of the pixels within the OD regions into OD, see
+  od_kernels.hh. Accumulate the moments of the ROI pixels per band
+  and, if the palette scale is known, color the row right away while
+  it is still in cache. Band rows count from FIRST_ROW. Pixels outside
+  of the OD regions and the RGB image outside of the ROI are left
+  alone, the display only ever shows the ROI.
+ */
+class FrameTask : public BandTask {
+  private:
+    const pixel_t* raw; // raw image, NULL for kinetics frames
+    const pixel_t* light; // kinetics images, LIGHT and DARK may be NULL
+    const pixel_t* shadow;
+    const pixel_t* dark;
+    float* od; // OD image of kinetics frames
+    const std::vector<wxRect>* od_rects; // regions to calculate the OD of
+    size_t width;
+    size_t first_row; // image row of band row 0
+    wxRect roi;
+    unsigned char* rgb; // NULL to leave coloring to a second pass
+    const PaletteTable* pal;
+
+    // Calculate the OD of row J where it lies within the OD regions,
+    // every pixel once.
+    void od_row(size_t j){
+      const size_t max_spans = IMAGE_WINDOW_MAX_MARKERS+1;
+      size_t x0[max_spans], x1[max_spans], n = 0;
+      for(size_t k=0; k<od_rects->size() && n<max_spans; ++k){
+        const wxRect& r = (*od_rects)[k];
+        if(r.IsEmpty() || (int)j < r.y || (int)j >= r.y + r.height){
+          continue;
+        }
+        size_t m = n++; // keep the spans sorted by x0
+        for(; m>0 && x0[m-1] > (size_t)r.x; --m){
+          x0[m] = x0[m-1];
+          x1[m] = x1[m-1];
+        }
+        x0[m] = r.x;
+        x1[m] = r.x + r.width;
+      }
+      size_t done = 0; // columns before DONE are calculated
+      for(size_t k=0; k<n; ++k){
+        size_t a = std::max(x0[k],done), b = x1[k];
+        if(a >= b){
+          continue;
+        }
+        size_t i = j*width + a;
+        if(light){
+          od_absorption(light+i,shadow+i,dark ? dark+i : NULL,od+i,b-a);
+        }
+        else{
+          od_log_counts(shadow+i,od+i,b-a);
+        }
+        done = b;
+      }
+    }
+
+    template <typename T>
+    void process_row(const T* row, size_t j, unsigned char* rgb_row, RoiMoments& m){
+      size_t x0 = roi.x, w = roi.width;
+      RowMoments r;
+      roi_row_moments(row+x0,w,r);
+      m.AddRow(r,w,(double)(j - roi.y));
+      if(rgb_row){
+        const unsigned char* c = NULL;
+        for(size_t i=x0; i<x0+w; ++i){
+          c = pal->Lookup((float)row[i]);
+          rgb_row[3*i] = c[0]; rgb_row[3*i+1] = c[1]; rgb_row[3*i+2] = c[2];
+        }
+      }
+    }
+
+  public:
+    std::vector<RoiMoments> bands;
+
+    FrameTask(const pixel_t* raw_, size_t width_, size_t first_row_,
+              const wxRect& roi_, size_t n_bands)
+      : raw(raw_), light(NULL), shadow(NULL), dark(NULL), od(NULL), od_rects(NULL),
+        width(width_), first_row(first_row_), roi(roi_),
+        rgb(NULL), pal(NULL),
+        bands(n_bands)
+    {}
+
+    // Calculate the OD image within the regions RECTS from the
+    // kinetics images instead of using the raw image. Without LIGHT,
+    // OD is the log of SHADOW.
+    void SetOD(const pixel_t* light_, const pixel_t* shadow_, const pixel_t* dark_, float* od_,
+               const std::vector<wxRect>* rects){
+      light = light_; shadow = shadow_; dark = dark_; od = od_; od_rects = rects; raw = NULL;
+    }
+
+    void SetColor(unsigned char* rgb_, const PaletteTable* pal_){
+      rgb = rgb_; pal = pal_;
+    }
+
+    void Run(size_t band, size_t row0, size_t row1){
+      RoiMoments m;
+      size_t y0 = roi.y, y1 = roi.y + roi.height;
+      for(size_t j=first_row+row0; j<first_row+row1; ++j){
+        if(od){
+          od_row(j);
+        }
+        if(j < y0 || j >= y1){
+          continue;
+        }
+        size_t i = j*width;
+        unsigned char* rgb_row = rgb ? rgb + 3*i : NULL;
+        if(od){
+          process_row(od+i,j,rgb_row,m);
+        }
+        else{
+          process_row(raw+i,j,rgb_row,m);
+        }
+      }
+      bands[band] = m;
+    }
+};
+
+// Let TASK calculate the OD within RECTS of kinetics frame F, split
+// into N_KINETICS images, into OD.
+static void set_kinetics_images(FrameTask& task, const Frame* f, unsigned int n_kinetics,
+                                float* od, const std::vector<wxRect>* rects)
+{
+  size_t subarea = (size_t)f->width * (f->height/n_kinetics);
+  const pixel_t* d = f->data;
+  if(n_kinetics == 3){ // dark, shadow, light
+    task.SetOD(d+2*subarea,d+subarea,d,od,rects);
+  }
+  else if(n_kinetics == 2){ // shadow, light, no dark picture
+    task.SetOD(d+subarea,d,NULL,od,rects);
+  }
+  else{ // only shadow picture
+    task.SetOD(NULL,d,NULL,od,rects);
+  }
+}
+
+
+
+void FrameView::Swap(FrameView& v){
+  std::swap(frame,v.frame);
+  std::swap(roi,v.roi);
+  std::swap(display_roi,v.display_roi);
+  std::swap(scale_x,v.scale_x);
+  std::swap(scale_y,v.scale_y);
+  std::swap(palette_min,v.palette_min);
+  std::swap(palette_max,v.palette_max);
+  roi_stat.swap(v.roi_stat);
+  marker_rois.swap(v.marker_rois);
+  marker_stat.swap(v.marker_stat);
+  std::swap(display_size,v.display_size);
+  rgb.swap(v.rgb);
+}
+
+
+FrameProcessor::FrameProcessor(wxEvtHandler* owner_, FrameRing* frame_ring_)
+  : wxThread(wxTHREAD_JOINABLE),
+    owner(owner_),
+    frame_ring(frame_ring_),
+    condition(mutex),
+    requests(0),
+    scale_next_image(false),
+    quit(false),
+    view_posted(false),
+    view_ready(false),
+    frame(NULL),
+    width(0),
+    height(0),
+    palette_min(0),
+    palette_max(0),
+    roi(0,0,0,0),
+    roi_stat(9,0.0f),
+    frame_processed(false),
+    summed_area_valid(false),
+    summed_area_row(0)
+{
+}
+
+void* FrameProcessor::Entry(){
+  while(true){
+    int request = 0;
+    {
+      wxMutexLocker lock(mutex);
+      while(!requests && !quit){
+        condition.Wait();
+      }
+      if(quit){
+        break;
+      }
+      request = requests;
+      requests = 0;
+      if(next_settings.kinetics != settings.kinetics ||
+         next_settings.n_kinetics != settings.n_kinetics)
+      {
+        frame_processed = false; // reprocess a held frame
+      }
+      settings = next_settings;
+    }
+
+    wxMutexLocker work(work_mutex);
+    bool data = (request & FRAME_PROCESSOR_DATA) != 0;
+    if((request & FRAME_PROCESSOR_FRAME) && acquire_frame()){
+      data = true;
+    }
+    if(!frame){
+      continue;
+    }
+    if(data){
+      process_data();
+    }
+    else if(request & FRAME_PROCESSOR_MARKERS){
+      marker_statistics();
+    }
+    make_view();
+    publish_view();
+  }
+  // The frame ring may be gone already, see ImageFrame::StopProcessing()
+  frame = NULL;
+  return NULL;
+}
+
+void FrameProcessor::Update(const FrameSettings& settings_, int request){
+  wxMutexLocker lock(mutex);
+  next_settings = settings_;
+  requests |= request;
+  condition.Signal();
+}
+
+void FrameProcessor::ScaleNextImage(){
+  wxMutexLocker lock(mutex);
+  scale_next_image = true;
+}
+
+bool FrameProcessor::TakeView(FrameView& v){
+  wxMutexLocker lock(mutex);
+  view_posted = false;
+  if(!view_ready){
+    return false;
+  }
+  v.Swap(ready);
+  view_ready = false;
+  return true;
+}
+
+void FrameProcessor::Quit(){
+  wxMutexLocker lock(mutex);
+  quit = true;
+  condition.Signal();
+}
+
+void FrameProcessor::SetThreadCount(size_t n){
+  wxMutexLocker work(work_mutex);
+  band_pool.SetThreadCount(n);
+}
+
+size_t FrameProcessor::GetThreadCount(){
+  wxMutexLocker work(work_mutex);
+  return band_pool.GetThreadCount();
+}
+
+// Color data T (raw pixels or OD) into RGB image using the palette
+// table and its current scale range. Limit the updated region of RGB
+// to region PALROI, and return the minimum TMIN and maximum TMAX of
+// T in PALROI.
+template <typename T>
+void FrameProcessor::interpolate_image(const T* t, unsigned char* rgb, const wxRect& palroi,
+                                       float& tmin, float& tmax)
+{
+  InterpolateTask<T> task(t,rgb,&settings.palette,width,palroi,
+                          band_pool.GetBandCount(palroi.height));
+  band_pool.Run(task,palroi.height);
+  tmin = *std::min_element(task.band_min.begin(),task.band_min.end());
+  tmax = *std::max_element(task.band_max.begin(),task.band_max.end());
+}
+
+/*
+  Pick up the newest frame from the frame ring, if there is one, and
+  keep holding it so that ROI changes can reprocess it. The previously
+  held frame goes back to the ring. The image data follows the frame
+  size, which changes with the camera readout area and binning.
+  Returns true if there is a new frame.
+ */
+bool FrameProcessor::acquire_frame(){
+  Frame* f = frame_ring->AcquireNewest();
+  if(!f){
+    return false;
+  }
+  if(f->GetArea() == 0){
+    frame_ring->Release(f);
+    return false;
+  }
+  frame_ring->Release(frame);
+  frame = f;
+  frame_processed = false;
+  if(frame->width != width || frame->height != height){
+    resize_data(frame->width,frame->height);
+  }
+  return true;
+}
+
+// Reallocate image data for a new frame size and show the full
+// frame. The GUI follows when it gets the view.
+void FrameProcessor::resize_data(unsigned int width_, unsigned int height_){
+  width = width_;
+  height = height_;
+  processed_data.assign((size_t)width*height,0.0f);
+  processed_rgb.assign(3*(size_t)width*height,0);
+  settings.roi = wxRect(0,0,width,height);
+  settings.marker_rois.clear();
+  marker_stat.clear();
+}
+
+// Area of the data the statistics refer to: the whole frame, or in
+// kinetics mode the first sub image, which holds the OD image.
+wxRect FrameProcessor::data_frame() const {
+  if(settings.kinetics){
+    return wxRect(0,0,width,height/settings.n_kinetics);
+  }
+  return wxRect(0,0,width,height);
+}
+
+/*
+  This is the meat. Process the held frame for the current ROI.
+
+  Convert the raw data into floating point representation, using OD
+  formula if required, calculate statistics of the ROI and update the
+  internal RGB image, all in one pass. Only when autoscaling the
+  palette to this image, the palette range depends on the
+  statistics, and the RGB image is updated in a second pass. Limit
+  the OD calculation and the color interpolation to ROI to increase
+  speed.
+
+  If the frame has been processed before and only the ROI changed,
+  the OD image is still there. Fill it in where the new ROI reaches
+  beyond it, look up the moments of the new ROI in the summed-area
+  table and recolor the ROI, which also finds its minimum and
+  maximum.
+ */
+void FrameProcessor::process_data(){
+  wxRect palroi = data_frame();
+  palroi.Intersect(settings.roi);
+
+  bool autoscale = false;
+  if(!settings.palette_scale_manual && !frame_processed){
+    wxMutexLocker lock(mutex);
+    autoscale = scale_next_image;
+    scale_next_image = false;
+  }
+  if(settings.palette_scale_manual){
+    palette_min = settings.palette_min_manual;
+    palette_max = settings.palette_max_manual;
+  }
+  settings.palette.SetRange(palette_min,palette_max);
+  const float* od = processed_data.empty() ? NULL : &processed_data[0];
+  unsigned char* rgb = processed_rgb.empty() ? NULL : &processed_rgb[0];
+  float tmin = 0, tmax = 0;
+  if(!frame_processed){
+    summed_area_valid = false;
+    process_frame(palroi,!autoscale);
+    frame_processed = true;
+    if(autoscale){
+      palette_min = roi_stat[0]; // ROI min
+      palette_max = roi_stat[1]; // ROI max
+      settings.palette.SetRange(palette_min,palette_max);
+      if(settings.kinetics){
+        interpolate_image(od,rgb,palroi,tmin,tmax);
+      }
+      else{
+        interpolate_image(frame->data,rgb,palroi,tmin,tmax);
+      }
+    }
+  }
+  else{
+    process_od(palroi);
+    if(settings.kinetics){
+      interpolate_image(od,rgb,palroi,tmin,tmax);
+    }
+    else{
+      interpolate_image(frame->data,rgb,palroi,tmin,tmax);
+    }
+    RoiMoments m;
+    summed_area_table().AddMoments(palroi.x,palroi.y,palroi.width,palroi.height,m);
+    m.tmin = tmin;
+    m.tmax = tmax;
+    roi_statistics(m,roi_stat);
+  }
+  marker_statistics();
+  roi = palroi;
+}
+
+/*
+  Run the single pass over the current frame, see FrameTask, and
+  calculate the statistics of PALROI. With COLOR, also update the
+  RGB image using the current palette scale. For kinetics mode,
+  calculate the optical density into the _beginning_ of
+  processed_data, but only within PALROI and the marker regions, so
+  that the cost follows the ROI rather than the chip. Other regions
+  are calculated on demand, see process_od(). A regular image is
+  analyzed straight from the 16 bit frame.
+ */
+void FrameProcessor::process_frame(const wxRect& palroi, bool color){
+  size_t row0 = palroi.y, row1 = palroi.y + palroi.height;
+  od_rects.clear();
+  if(settings.kinetics){
+    wxRect d = data_frame();
+    od_rects.push_back(palroi);
+    for(size_t k=0; k<settings.marker_rois.size(); ++k){
+      wxRect r = settings.marker_rois[k];
+      r.Intersect(d);
+      if(!r.IsEmpty()){
+        od_rects.push_back(r);
+        row0 = std::min(row0,(size_t)r.y);
+        row1 = std::max(row1,(size_t)(r.y + r.height));
+      }
+    }
+  }
+  FrameTask task(frame->data,width,row0,palroi,band_pool.GetBandCount(row1-row0));
+  if(settings.kinetics){
+    set_kinetics_images(task,frame,settings.n_kinetics,&processed_data[0],&od_rects);
+  }
+  if(color){
+    task.SetColor(&processed_rgb[0],&settings.palette);
+  }
+  band_pool.Run(task,row1-row0);
+  RoiMoments m;
+  for(size_t b=0; b<task.bands.size(); ++b){
+    m.Add(task.bands[b]);
+  }
+  roi_statistics(m,roi_stat);
+}
+
+/*
+  Calculate the OD of region R of the current kinetics frame, unless
+  process_frame() or an earlier call already did. Fills in the OD
+  image for ROIs that come up after the frame was processed.
+ */
+void FrameProcessor::process_od(const wxRect& r){
+  if(!settings.kinetics || !frame || r.IsEmpty()){
+    return;
+  }
+  for(size_t k=0; k<od_rects.size(); ++k){
+    if(od_rects[k].Contains(r)){
+      return;
+    }
+  }
+  std::vector<wxRect> rects(1,r);
+  FrameTask task(frame->data,width,r.y,wxRect(0,0,0,0),band_pool.GetBandCount(r.height));
+  set_kinetics_images(task,frame,settings.n_kinetics,&processed_data[0],&rects);
+  band_pool.Run(task,r.height);
+  od_rects.push_back(r);
+  summed_area_row = std::min(summed_area_row,(unsigned int)r.y);
+}
+
+/*
+  Summed-area table of the current frame, see SummedAreaTable. Only
+  built when asked for, at most once per frame, after process_frame()
+  has calculated the OD image. Outside of the OD regions, the OD
+  image holds stale but finite values, which cancel out of the sums
+  of any rectangle within the OD regions. When process_od() fills in
+  a region later on, only the table rows below its top are rebuilt.
+ */
+const SummedAreaTable& FrameProcessor::summed_area_table(){
+  wxRect d = data_frame();
+  if(!summed_area_valid){
+    if(settings.kinetics){
+      summed_area.Build(&processed_data[0],d.width,d.height,band_pool);
+    }
+    else{
+      summed_area.Build(frame->data,d.width,d.height,band_pool);
+    }
+    summed_area_valid = true;
+  }
+  else if(summed_area_row < (unsigned int)d.height){
+    summed_area.Update(&processed_data[0],summed_area_row,band_pool);
+  }
+  summed_area_row = d.height;
+  return summed_area;
+}
+
+/*
+  Turn the moments M of a ROI into statistics STAT. The center of
+  mass and the second moments weight the ROI coordinates with the
+  pixel values. Variances are taken about the center of mass in
+  double precision.
+ */
+void FrameProcessor::roi_statistics(const RoiMoments& m, std::vector<float>& stat){
+  RoiMoments t = m;
+  if(t.n == 0){
+    t.tmin = t.tmax = 0;
+  }
+  double m1 = t.s.Get();
+  double cmx = 0, cmy = 0, varx = 0, vary = 0, cov = 0;
+  if(m1 != 0){
+    cmx = t.sx.Get() / m1;
+    cmy = t.sy.Get() / m1;
+    varx = t.sxx.Get() / m1 - cmx*cmx;
+    vary = t.syy.Get() / m1 - cmy*cmy;
+    cov = t.sxy.Get() / m1 - cmx*cmy;
+  }
+  stat.resize(9);
+  stat[0] = t.tmin; // minimum
+  stat[1] = t.tmax; // maximum
+  stat[2] = (float)m1; // integrated
+  stat[3] = t.n>0 ? (float)(m1/t.n) : 0; // mean
+  stat[4] = (float)sqrt(std::max(varx,0.0)); // rms width x
+  stat[5] = (float)sqrt(std::max(vary,0.0)); // rms width y
+  stat[6] = (float)cmx; // center of mass x
+  stat[7] = (float)cmy; // center of mass y
+  stat[8] = (float)cov; // covariance xy
+}
+
+/*
+  Statistics of the marker regions, looked up in the summed-area
+  table. The table has no minimum and maximum, so these entries of
+  marker_stat are meaningless.
+ */
+void FrameProcessor::marker_statistics(){
+  const std::vector<wxRect>& markers = settings.marker_rois;
+  marker_stat.resize(markers.size());
+  if(markers.empty() || !frame || !frame_processed){
+    return;
+  }
+  wxRect d = data_frame();
+  for(size_t k=0; k<markers.size(); ++k){
+    process_od(wxRect(markers[k]).Intersect(d));
+  }
+  const SummedAreaTable& sat = summed_area_table();
+  for(size_t k=0; k<markers.size(); ++k){
+    wxRect r = markers[k];
+    r.Intersect(d);
+    RoiMoments m;
+    if(!r.IsEmpty()){
+      sat.AddMoments(r.x,r.y,r.width,r.height,m);
+    }
+    roi_statistics(m,marker_stat[k]);
+  }
+}
+
+/*
+  Fill in the view of the processed frame. Cut out the ROI from the
+  RGB image, rotate it and rescale it into the display buffer,
+  centered, see ImageResampler.
+ */
+void FrameProcessor::make_view(){
+  size_t W = std::max(settings.display_size.GetWidth(),0);
+  size_t H = std::max(settings.display_size.GetHeight(),0);
+  size_t w = 0, h = 0;
+  if(!roi.IsEmpty()){
+    view.scale_x = ((float)W) / roi.width;
+    view.scale_y = ((float)H) / roi.height;
+    float scale = std::min(view.scale_x,view.scale_y);
+    w = std::min((size_t)(scale * roi.width),W);
+    h = std::min((size_t)(scale * roi.height),H);
+  }
+  if(view.scale_x < view.scale_y){
+    view.display_roi = wxRect(0,(H - h) / 2,w,h);
+  }
+  else{
+    view.display_roi = wxRect((W - w) / 2,0,w,h);
+  }
+  view.display_size = wxSize(W,H);
+  view.rgb.resize(3*W*H);
+  if(W > 0 && H > 0){
+    resampler.SetMode(settings.resampling);
+    resampler.Run(&processed_rgb[0],width,roi,&view.rgb[0],W,H,view.display_roi);
+  }
+
+  view.frame = *frame;
+  view.frame.data = NULL;
+  view.frame.capacity = 0;
+  view.roi = roi;
+  view.palette_min = palette_min;
+  view.palette_max = palette_max;
+  view.roi_stat = roi_stat;
+  view.marker_rois = settings.marker_rois;
+  view.marker_stat = marker_stat;
+}
+
+// Hand the view over as the newest one, and tell the owner unless an
+// earlier event is still waiting.
+void FrameProcessor::publish_view(){
+  bool post = false;
+  {
+    wxMutexLocker lock(mutex);
+    ready.Swap(view);
+    view_ready = true;
+    post = !view_posted;
+    view_posted = true;
+  }
+  if(post){
+    wxCommandEvent evt(wxEVT_IMAGE_PANEL,ID_IMAGE_WINDOW_FRAME_PROCESSED);
+    wxPostEvent(owner,evt);
+  }
+}
+
+
+// frame_processor.cc ends here
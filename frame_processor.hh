@@ -0,0 +1,180 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-18 04:12:36 sb"
+
+/*
+  file       frame_processor.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef FRAME_PROCESSOR_HH
+#define FRAME_PROCESSOR_HH
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <vector>
+
+#include "band_pool.hh"
+#include "frame_ring.hh"
+#include "palette_table.hh"
+#include "resampler.hh"
+#include "roi_moments.hh"
+#include "summed_area.hh"
+
+// Number of marker regions, see ImageFrame::OnCaretDone()
+#define IMAGE_WINDOW_MAX_MARKERS 8
+
+// Work asked for with FrameProcessor::Update(), or-ed together
+enum FrameProcessorRequest {
+  FRAME_PROCESSOR_FRAME = 1,   // pick up the newest frame of the frame ring
+  FRAME_PROCESSOR_DATA = 2,    // ROI or processing changed, reprocess the held frame
+  FRAME_PROCESSOR_MARKERS = 4, // marker regions changed
+  FRAME_PROCESSOR_DISPLAY = 8  // display size or resampling changed
+};
+
+// How the GUI wants frames processed and displayed. The processor
+// works on its own copy, see FrameProcessor::Update().
+class FrameSettings {
+  public:
+    wxRect roi; // requested Region Of Interest in the data frame
+    std::vector<wxRect> marker_rois; // marker regions in the data frame
+    bool kinetics; // calculate the OD from kinetics sub images?
+    unsigned int n_kinetics; // number of kinetics sub images
+    bool palette_scale_manual; // use manual palette scale?
+    float palette_min_manual; // manual setting for palette minimum
+    float palette_max_manual; // manual setting for palette maximum
+    PaletteTable palette; // palette and scaling, the processor sets the range
+    ResampleMode resampling; // how the ROI is scaled for display
+    wxSize display_size; // size of the display buffer in px
+
+    FrameSettings()
+      : roi(0,0,0,0), kinetics(false), n_kinetics(3),
+        palette_scale_manual(false), palette_min_manual(0), palette_max_manual(0),
+        resampling(RESAMPLE_NEAREST), display_size(0,0)
+    {}
+};
+
+// A processed frame, ready for display, see FrameProcessor::TakeView().
+class FrameView {
+  public:
+    Frame frame; // frame shown, without its pixel data
+    wxRect roi; // ROI shown, within the data frame
+    wxRect display_roi; // display area the ROI is scaled into
+    float scale_x; // X scaling factor between data and display frames
+    float scale_y; // Y scaling factor between data and display frames
+    float palette_min; // floating point value corresponding to palette minimum
+    float palette_max; // floating point value corresponding to palette maximum
+    std::vector<float> roi_stat; // ROI statistics
+    std::vector<wxRect> marker_rois; // marker regions marker_stat belongs to
+    std::vector<std::vector<float> > marker_stat; // statistics of the marker regions
+    wxSize display_size; // size of the display buffer in px
+    std::vector<unsigned char> rgb; // display buffer, 3 bytes per pixel
+
+    FrameView()
+      : roi(0,0,0,0), display_roi(0,0,0,0), scale_x(1.0f), scale_y(1.0f),
+        palette_min(0), palette_max(0), roi_stat(9,0.0f), display_size(0,0)
+    {}
+    // Exchange contents with V without copying the buffers
+    void Swap(FrameView& v);
+};
+
+/*
+  Turns camera frames into display buffers and statistics on its own
+  thread, so that the GUI thread only copies finished pixels to the
+  screen. Update() hands over the settings of the GUI together with
+  a request, and the processor works on the newest settings and the
+  newest frame of the frame ring. Requests arriving while a frame is
+  processed are merged, so a processor that falls behind skips
+  frames rather than queuing them.
+
+  Each finished FrameView is announced to the owner by an event
+  wxEVT_IMAGE_PANEL with id ID_IMAGE_WINDOW_FRAME_PROCESSED, at most
+  one at a time until the owner calls TakeView(). A newer view
+  replaces one the owner has not taken yet.
+
+  The processor holds on to the frame it shows, so that ROI changes
+  can reprocess it, see ImageFrame.
+ */
+class FrameProcessor : public wxThread {
+  private:
+    wxEvtHandler* owner; // receives ID_IMAGE_WINDOW_FRAME_PROCESSED
+    FrameRing* frame_ring;
+
+    wxMutex mutex; // protects everything up to ready
+    wxCondition condition; // signaled on new requests and quit
+    int requests; // FrameProcessorRequest flags not handled yet
+    FrameSettings next_settings; // settings from the last Update()
+    bool scale_next_image; // autoscale palette to next image?
+    bool quit;
+    bool view_posted; // event posted and view not taken yet
+    bool view_ready; // ready holds a view not taken yet
+    FrameView ready; // newest finished view
+
+    wxMutex work_mutex; // held while processing, protects band_pool
+
+    // Processing thread only
+    FrameSettings settings; // settings the current view is made with
+    Frame* frame; // frame processed, held until a newer one arrives
+    unsigned int width; // image data width, follows the frame size
+    unsigned int height; // image data height, follows the frame size
+    std::vector<float> processed_data; // OD image calculated from kinetics frames
+    std::vector<unsigned char> processed_rgb; // colored data, 3 bytes per pixel
+    ImageResampler resampler; // crops, rotates and rescales processed_rgb for display
+    float palette_min; // floating point value corresponding to palette minimum
+    float palette_max; // floating point value corresponding to palette maximum
+    wxRect roi; // ROI processed, within the data frame
+    std::vector<float> roi_stat; // ROI statistics
+    std::vector<std::vector<float> > marker_stat; // statistics of the marker regions
+    BandPool band_pool; // splits OD, statistics and color mapping over the cores
+    bool frame_processed; // processed_data and statistics belong to frame
+    std::vector<wxRect> od_rects; // regions of processed_data holding the OD of frame
+    SummedAreaTable summed_area; // moments of frame, see summed_area_table()
+    bool summed_area_valid; // summed_area belongs to frame
+    unsigned int summed_area_row; // first OD row changed since summed_area was built
+    FrameView view; // view being made
+
+    FrameProcessor(const FrameProcessor&) : condition(mutex) {}
+
+    template <typename T>
+    void interpolate_image(const T* t, unsigned char* rgb, const wxRect& palroi,
+                           float& tmin, float& tmax);
+    bool acquire_frame();
+    void resize_data(unsigned int width_, unsigned int height_);
+    wxRect data_frame() const;
+    void process_data();
+    void process_frame(const wxRect& palroi, bool color);
+    void process_od(const wxRect& r);
+    const SummedAreaTable& summed_area_table();
+    void roi_statistics(const RoiMoments& m, std::vector<float>& stat);
+    void marker_statistics();
+    void make_view();
+    void publish_view();
+
+  public:
+    FrameProcessor(wxEvtHandler* owner_, FrameRing* frame_ring_);
+
+    virtual void* Entry();
+
+    // Process with SETTINGS_ from now on, doing the work REQUEST of
+    // FrameProcessorRequest flags. Called from the GUI thread.
+    void Update(const FrameSettings& settings_, int request);
+    // Autoscale the palette to the next frame processed
+    void ScaleNextImage();
+    // Move the newest finished view into V. Returns false if there is
+    // none since the last call.
+    bool TakeView(FrameView& v);
+    // End the thread after the current frame. The held frame is not
+    // handed back to the frame ring.
+    void Quit();
+
+    // Number of image processing threads, 0 for one per core. Waits
+    // for the current frame.
+    void SetThreadCount(size_t n);
+    size_t GetThreadCount();
+};
+
+
+#endif // FRAME_PROCESSOR_HH
+
+// frame_processor.hh ends here
@@ -0,0 +1,211 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 11:02:55 sb"
+
+/*
+  file       frame_ring.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "frame_ring.hh"
+
+#include <algorithm>
+
+
+FrameRing::FrameRing(size_t n_slots_)
+  : slots(NULL),
+    n_slots(n_slots_),
+    latest(-1),
+    published(0),
+    consumed(0),
+    dropped(0),
+    overwritten(0),
+    skipped(0),
+    notify_pending(0),
+    last_written(-1)
+{
+  slots = new Slot[n_slots];
+  for(size_t i=0; i<n_slots; ++i){
+    slots[i].refs = 0;
+    slots[i].seen = 1;
+  }
+}
+
+FrameRing::~FrameRing(){
+  free_slots();
+  if(slots){
+    delete[] slots;
+    slots = NULL;
+  }
+}
+
+// Frame is the first member of Slot, so the slot index follows from
+// the frame address.
+long FrameRing::slot_index(const Frame* frame) const {
+  return (long)(reinterpret_cast<const Slot*>(frame) - slots);
+}
+
+void FrameRing::free_slots(){
+  for(size_t i=0; i<n_slots; ++i){
+    Frame& f = slots[i].frame;
+    if(f.data){
+      delete[] f.data;
+      f.data = NULL;
+    }
+    f.capacity = 0;
+    f.seq = 0;
+  }
+}
+
+// Preallocate all slots. Fails if any slot is still in use, so this
+// must happen before the first frame is published.
+bool FrameRing::Allocate(size_t capacity){
+  if(!n_slots){
+    return false;
+  }
+  for(size_t i=0; i<n_slots; ++i){
+    if(atomic_get(&slots[i].refs) != 0){
+      return false;
+    }
+  }
+  if(slots[0].frame.data && slots[0].frame.capacity >= capacity){
+    return true;
+  }
+  atomic_set(&latest,-1);
+  free_slots();
+  for(size_t i=0; i<n_slots; ++i){
+    Frame& f = slots[i].frame;
+    f.data = new pixel_t[capacity];
+    f.capacity = capacity;
+    std::fill(f.data,f.data+capacity,0);
+    atomic_set(&slots[i].seen,1);
+  }
+  return true;
+}
+
+/*
+  Reserve a slot for the producer. Prefer slots that are unused or
+  whose frame was already consumed. Otherwise recycle the oldest
+  unconsumed frame, but never the one the consumer is about to pick
+  up unless it is the only slot left. Returns NULL if every slot is
+  held by a consumer.
+ */
+Frame* FrameRing::BeginWrite(){
+  if(!n_slots || !slots[0].frame.data){
+    return NULL;
+  }
+  long newest = atomic_get(&latest);
+  long victim = -1;
+  long victim_seq = 0;
+  for(size_t k=1; k<=n_slots; ++k){
+    long i = (long)((last_written + k) % n_slots);
+    Slot& s = slots[i];
+    if(atomic_get(&s.refs) != 0){
+      continue;
+    }
+    if(s.frame.seq == 0 || atomic_get(&s.seen)){
+      if(atomic_cas(&s.refs,0,-1)){
+        last_written = i;
+        return &s.frame;
+      }
+    }
+    else if(i != newest && (victim < 0 || s.frame.seq < victim_seq)){
+      victim = i;
+      victim_seq = s.frame.seq;
+    }
+  }
+  if(victim < 0 && newest >= 0){
+    victim = newest;
+  }
+  if(victim >= 0 && atomic_cas(&slots[victim].refs,0,-1)){
+    if(!atomic_get(&slots[victim].seen)){
+      atomic_add(&overwritten,1);
+    }
+    last_written = victim;
+    return &slots[victim].frame;
+  }
+  atomic_add(&dropped,1);
+  return NULL;
+}
+
+// Publish FRAME with the next sequence number and make it the newest
+// frame. If HOLD, the caller keeps a reference that has to be returned
+// with Release().
+void FrameRing::EndWrite(Frame* frame, bool hold){
+  long i = slot_index(frame);
+  Slot& s = slots[i];
+  s.frame.seq = atomic_get(&published) + 1;
+  atomic_set(&s.seen,0);
+  atomic_set(&s.refs,hold ? 1 : 0);
+  atomic_set(&latest,i);
+  atomic_set(&published,s.frame.seq);
+}
+
+// Return FRAME to the pool without publishing it. Its previous
+// content may be partially overwritten, so mark it as unused.
+void FrameRing::CancelWrite(Frame* frame){
+  long i = slot_index(frame);
+  Slot& s = slots[i];
+  atomic_cas(&latest,i,-1);
+  s.frame.seq = 0;
+  atomic_set(&s.seen,1);
+  atomic_set(&s.refs,0);
+}
+
+/*
+  Return the newest published frame that has not been handed out
+  before, or NULL if there is none. The frame stays valid until it is
+  returned with Release().
+ */
+Frame* FrameRing::AcquireNewest(){
+  for(size_t attempt=0; attempt<2*n_slots; ++attempt){
+    long i = atomic_get(&latest);
+    if(i < 0){
+      return NULL;
+    }
+    Slot& s = slots[i];
+    long r = atomic_get(&s.refs);
+    if(r < 0){
+      // producer is recycling the newest slot, nothing to show yet
+      if(atomic_get(&latest) == i){
+        return NULL;
+      }
+      continue;
+    }
+    if(!atomic_cas(&s.refs,r,r+1)){
+      continue;
+    }
+    if(s.frame.seq == 0 || s.frame.seq <= atomic_get(&consumed)){
+      atomic_add(&s.refs,-1);
+      if(atomic_get(&latest) == i){
+        return NULL;
+      }
+      continue;
+    }
+    atomic_set(&s.seen,1);
+    long c = atomic_get(&consumed);
+    if(s.frame.seq > c+1){
+      atomic_add(&skipped,s.frame.seq-c-1);
+    }
+    atomic_set(&consumed,s.frame.seq);
+    return &s.frame;
+  }
+  return NULL;
+}
+
+void FrameRing::Release(Frame* frame){
+  if(!frame){
+    return;
+  }
+  long i = slot_index(frame);
+  atomic_add(&slots[i].refs,-1);
+}
+
+void FrameRing::ResetCounters(){
+  atomic_set(&dropped,0);
+  atomic_set(&overwritten,0);
+  atomic_set(&skipped,0);
+}
+
+
+// frame_ring.cc ends here
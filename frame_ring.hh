@@ -0,0 +1,140 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 10:31:07 sb"
+
+/*
+  file       frame_ring.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef FRAME_RING_HH
+#define FRAME_RING_HH
+
+#include <cstddef>
+#include <stdint.h>
+
+#include "atomic_ops.hh"
+
+// Number of preallocated frame slots. Needs to be at least three so
+// that the camera always finds a free slot while the display holds
+// one frame and another one is waiting to be displayed. Slots beyond
+// that hold frames queued for the image writer.
+#define FRAME_RING_SLOTS 8
+
+// Raw camera pixels. The CCD digitizes to 16 bit, so frames are
+// downloaded with the 16 bit SDK calls.
+typedef uint16_t pixel_t;
+
+/*
+  One downloaded camera image. In kinetics mode, the N_IMAGES sub
+  images are stacked vertically, each of size WIDTH x
+  (HEIGHT/N_IMAGES). Pixel (i,j) of every sub image covers the chip
+  pixels starting at (X0 + i*HBIN, Y0 + j*VBIN).
+ */
+class Frame {
+  public:
+    pixel_t* data; // pixel data, CAPACITY pixels allocated
+    size_t capacity; // number of allocated pixels
+    unsigned int width; // image width in px
+    unsigned int height; // total image height in px
+    unsigned int n_images; // number of kinetics sub images
+    int x0; // chip column of the first pixel
+    int y0; // chip row of the first pixel
+    unsigned int hbin; // horizontal binning
+    unsigned int vbin; // vertical binning
+    long seq; // sequence number, assigned when published
+    long number; // image number in the run, counting images the camera missed
+    long shot; // shot of the ShotTimeline that took the image, -1 if none
+    double timestamp; // acquisition time from monotonic_ms()
+
+    Frame()
+      : data(NULL), capacity(0), width(0), height(0), n_images(0),
+        x0(0), y0(0), hbin(1), vbin(1), seq(0), number(0), shot(-1), timestamp(0)
+    {}
+    size_t GetArea() const {return (size_t)width*height;}
+};
+
+/*
+  Preallocated ring of frame slots for single-producer /
+  single-consumer hand-off of camera images without locking.
+
+  The camera thread fills a free slot between BeginWrite() and
+  EndWrite(), which publishes the frame with the next sequence
+  number. The display calls AcquireNewest() to get the most recent
+  published frame it has not seen yet and hands it back with
+  Release(). The producer may keep a reference when publishing to
+  hand the frame to another consumer, such as the image writer, which
+  also returns it with Release(). Neither side ever waits for the
+  other. If every slot is
+  busy, the producer drops the frame. If the producer has to recycle
+  a slot holding a frame the consumer never saw, that frame counts as
+  overwritten.
+
+  The producer tells the consumer about new frames only when
+  ClaimNotify() says so, which is once until the consumer calls
+  NotifyHandled(). A consumer that falls behind thus gets a single
+  notification for any number of frames and picks the newest, the
+  frames in between count as skipped.
+ */
+class FrameRing {
+  private:
+    struct Slot {
+      Frame frame; // has to stay the first member, see slot_index()
+      atomic_long_t refs; // consumers holding the slot, -1 while writing
+      atomic_long_t seen; // frame was handed to the consumer
+    };
+
+    Slot* slots;
+    size_t n_slots;
+    atomic_long_t latest; // index of newest published slot or -1
+    atomic_long_t published; // sequence number of newest published frame
+    atomic_long_t consumed; // sequence number of newest consumed frame
+    atomic_long_t dropped; // frames dropped since all slots were busy
+    atomic_long_t overwritten; // frames recycled before being consumed
+    atomic_long_t skipped; // frames never consumed because newer ones were
+    atomic_long_t notify_pending; // consumer was notified and did not handle it yet
+
+    long last_written; // producer only: slot index written last
+
+    FrameRing(const FrameRing&){}
+    long slot_index(const Frame* frame) const;
+    void free_slots();
+
+  public:
+    FrameRing(size_t n_slots_=FRAME_RING_SLOTS);
+    ~FrameRing();
+
+    // Allocate CAPACITY pixels per slot. Has to be called by the
+    // producer before publishing the first frame.
+    bool Allocate(size_t capacity);
+    size_t GetCapacity() const {return n_slots ? slots[0].frame.capacity : 0;}
+    size_t GetSlots() const {return n_slots;}
+
+    // Producer side
+    Frame* BeginWrite();
+    void EndWrite(Frame* frame, bool hold=false);
+    void CancelWrite(Frame* frame);
+
+    // Producer side: true if the consumer has to be notified of
+    // the frames published so far
+    bool ClaimNotify(){return atomic_cas(&notify_pending,0,1);}
+
+    // Consumer side
+    Frame* AcquireNewest();
+    void Release(Frame* frame);
+    // Frames published from now on notify the consumer again. Call
+    // before AcquireNewest().
+    void NotifyHandled(){atomic_set(&notify_pending,0);}
+
+    long GetPublished() {return atomic_get(&published);}
+    long GetDropped() {return atomic_get(&dropped);}
+    long GetOverwritten() {return atomic_get(&overwritten);}
+    long GetSkipped() {return atomic_get(&skipped);}
+    void ResetCounters();
+};
+
+
+#endif // FRAME_RING_HH
+
+// frame_ring.hh ends here
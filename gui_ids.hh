@@ -23,18 +23,26 @@
 #define ID_CAMERA_EXPERIMENT_BEGIN 7
 #define ID_CAMERA_EXPERIMENT_END 8
 #define ID_CAMERA_IMAGE_READY 9
+#define ID_CAMERA_IMAGE_SAVED 19
 
 #define ID_CMD_BEGIN_EXPERIMENT 10
 #define ID_CMD_ABORT_EXPERIMENT 11
 #define ID_CMD_SCALE_NEXT_IMAGE 12
 
-#define ID_TEMPERATURE_TIMER 13
+#define ID_TELEMETRY_TIMER 13
 
 #define ID_IMAGE_WINDOW_CARET_DONE 14
 
 #define ID_FILE_SORTER_WORKER 15
 #define ID_FILE_SORTER_WORKER_DONE 16
 
+#define ID_IMAGE_WINDOW_READOUT_ROI 17
+
+#define ID_SAVE_SHOT_TIMELINE 18
+
+#define ID_IMAGE_WINDOW_FRAME_PROCESSED 20
+#define ID_IMAGE_WINDOW_FRAME_SHOWN 21
+
 #endif // GUI_IDS_HH
 
 // gui_ids.hh ends here
@@ -23,7 +23,7 @@ void interpolate_color(float t, unsigned char* rgb, unsigned char* pal, size_t n
   float x = t*(n-1);
   unsigned char z=0;
   size_t j = (size_t)floor(x);
-  if(j>=n){j=n-1;}
+  if(j>=n-1){j=n-2;} // T = 1 is the last color, do not read beyond PAL
   x -= j;
   j *= 3;
   z = pal[j];   rgb[0] = z + (unsigned char)((pal[j+3]-z) * x);
@@ -161,6 +161,8 @@ ImagePanel::ImagePanel(wxFrame* parent,
   minor_tick_length(3),
   com_display(true),
   com(0,0),
+  marker_display(true),
+  marker_stat(NULL),
   statistics_display(true),
   roi_stat(NULL),
   roi_labels(NULL),
@@ -191,26 +193,34 @@ void ImagePanel::SetDisplaySize(size_t display_width_, size_t display_height_){
   display_rect = wxRect(display_pad_w,display_pad_h,
                         display_width-2*display_pad_w,
                         display_height-2*display_pad_h);
+  if(display_rect.width > 0 && display_rect.height > 0 &&
+     (display_image.GetWidth() != display_rect.width ||
+      display_image.GetHeight() != display_rect.height))
+  {
+    display_image.Create(display_rect.width,display_rect.height);
+  }
   palette_bmp_w = display_width-10;
   palette_bmp_h = 10;
   if(info_palette){
     palette_bmp.Create(palette_bmp_w,palette_bmp_h);
     palette_mdc.SelectObject(palette_bmp);
-    SetPaletteInfo(info_palette,info_palette_size);
+    SetPaletteInfo(info_palette);
   }
 }
 
-void ImagePanel::SetPaletteInfo(unsigned char* p, size_t size){
-  if(!p || !size){
+// Draw the palette gradient, including the scaling. Call again when
+// the scaling of P changes.
+void ImagePanel::SetPaletteInfo(const PaletteTable* p){
+  if(!p){
     return;
   }
   info_palette = p;
-  info_palette_size = size;
+  info_palette_size = p->GetPaletteSize();
 
   float dt = 1.0f/palette_bmp_w;
-  unsigned char rgb[3] ={0,0,0};
+  const unsigned char* rgb = NULL;
   for(size_t i=0; i<palette_bmp_w; ++i){
-    interpolate_color(i*dt,rgb,info_palette,info_palette_size);
+    rgb = info_palette->GetColor(i*dt);
     wxPen pen = wxPen(wxColour(rgb[0],rgb[1],rgb[2]));
     palette_mdc.SetPen(pen);
     palette_mdc.DrawLine(i,0,i,palette_bmp_h);
@@ -290,28 +300,51 @@ void ImagePanel::draw_palette_info(wxDC& dc){
 }
 
 
+// Draw the ROI statistics, followed by a line for each marker region.
 void ImagePanel::draw_statistics_info(wxDC& dc){
   if(!roi_stat || !roi_labels){
     return;
   }
+  size_t y0 = statistics_y0;
+  y0 += draw_statistics_line(dc,wxT(""),*roi_stat,0,y0);
+  if(!marker_display || !marker_stat){
+    return;
+  }
+  for(size_t k=0; k<marker_stat->size(); ++k){
+    y0 += draw_statistics_line(dc,wxString::Format(wxT("#%d "),(int)k+1),
+                               (*marker_stat)[k],2,y0);
+  }
+}
+
+// Draw PREFIX and entries FIRST, ... of STAT at height Y0. Returns the
+// line height.
+size_t ImagePanel::draw_statistics_line(wxDC& dc, const wxString& prefix,
+                                        const std::vector<float>& stat,
+                                        size_t first, size_t y0)
+{
   std::ostringstream os;
-  wxSize s;
+  wxSize s = dc.GetTextExtent(wxT("0"));
   wxString o;
-  size_t x0 = statistics_x0, y0 = statistics_y0;
-  for(size_t i=0; i<roi_stat->size(); ++i){
+  size_t x0 = statistics_x0;
+  if(!prefix.IsEmpty()){
+    dc.DrawText(prefix,x0,y0);
+    x0 += dc.GetTextExtent(prefix).GetWidth();
+  }
+  for(size_t i=first; i<stat.size() && i<roi_labels->size(); ++i){
     o = (*roi_labels)[i] + ": ";
     dc.DrawText(o,x0,y0);
     s = dc.GetTextExtent(o);
     x0 += s.GetWidth();
 
     os.precision(2);
-    os << (*roi_stat)[i];
+    os << stat[i];
     o = wxString::FromAscii(os.str().c_str());
     os.str("");
     s = dc.GetTextExtent(o);
     dc.DrawText(o,x0,y0);
     x0 += s.GetWidth() + 10;
   }
+  return s.GetHeight();
 }
 
 
@@ -351,6 +384,18 @@ void ImagePanel::OnPaint(wxPaintEvent&){
     dc.SetBrush(*wxTRANSPARENT_BRUSH);
     dc.DrawCircle(com.x,com.y,5);
   }
+  if(marker_display){
+    dc.SetPen(*wxRED_PEN);
+    dc.SetBrush(*wxTRANSPARENT_BRUSH);
+    for(size_t k=0; k<markers.size(); ++k){
+      const wxRect& m = markers[k];
+      if(m.IsEmpty()){
+        continue;
+      }
+      dc.DrawRectangle(m.x,m.y,m.width,m.height);
+      dc.DrawText(wxString::Format(wxT("#%d"),(int)k+1),m.x+2,m.y+1);
+    }
+  }
   if(statistics_display){
     draw_statistics_info(dc);
   }
@@ -370,6 +415,16 @@ void ImagePanel::OnPaint(wxPaintEvent&){
 }
 
 
+// Marker regions M in display coordinates, empty ones are not drawn
+void ImagePanel::SetMarkers(const std::vector<wxRect>& m){
+  markers = m;
+  for(size_t k=0; k<markers.size(); ++k){
+    if(!markers[k].IsEmpty()){
+      markers[k].Offset(display_pad_w,display_pad_h);
+    }
+  }
+}
+
 void ImagePanel::RecreateBitmap(const wxImage& new_image){
   FreeBitmap();
   bmp = wxBitmap(new_image);
@@ -426,7 +481,7 @@ void ImagePanel::OnMouseLeftUp(wxMouseEvent& evt){
 
     //wxLogMessage(wxT("Caret done  : %d %d %d %d"),caret.x,caret.y,caret.width,caret.height);
     //wxLogMessage(wxT("Caret final : %d %d %d %d"),caret_final.x,caret_final.y,caret_final.width,caret_final.height);
-    zoom_in = !evt.ShiftDown();
+    zoom_in = !evt.ShiftDown() && !select_marker;
     wxCommandEvent evt = wxCommandEvent(wxEVT_IMAGE_PANEL,ID_IMAGE_WINDOW_CARET_DONE);
     wxPostEvent(this,evt);
     Refresh();
@@ -493,7 +548,10 @@ void DataPanel::OnPaint(wxPaintEvent&){
 
 BEGIN_EVENT_TABLE(ImageFrame,wxFrame)
 EVT_COMMAND(ID_IMAGE_WINDOW_CARET_DONE,wxEVT_IMAGE_PANEL,ImageFrame::OnCaretDone)
+EVT_COMMAND(ID_IMAGE_WINDOW_FRAME_PROCESSED,wxEVT_IMAGE_PANEL,ImageFrame::OnFrameProcessed)
 EVT_SIZE(ImageFrame::OnResize)
+EVT_ICONIZE(ImageFrame::OnIconize)
+EVT_SHOW(ImageFrame::OnShow)
 END_EVENT_TABLE()
 
 
@@ -522,119 +580,48 @@ void ImageFrame::create_palette(){
   palette[3*5 + 0] = 0xff; // white
   palette[3*5 + 1] = 0xff;
   palette[3*5 + 2] = 0xff;
+  settings.palette.SetPalette(palette,palette_size);
 }
 
-// Interpolate floating point data T between T0 and T1 into RGB image
-// using palette PAL of size NPAL. Limit the updated region of RGB to
-// region PALROI.
-void ImageFrame::interpolate_image(float* t, float t0, float t1, unsigned char* rgb,
-                                   unsigned char* pal, size_t npal, const wxRect& palroi)
-{
-  std::fill(rgb,rgb+3*width*height,0);
-  size_t idx = 0;
-  for(int j=0; j<palroi.height; ++j){
-    for(int i=0; i<palroi.width; ++i){
-      idx = (palroi.y + j)*width + (palroi.x+i);
-      interpolate_color(t[idx],t0,t1,&(rgb[3*idx]),pal,npal);
-    }
-  }
+void ImageFrame::SetPaletteScaling(PaletteScaling scaling, float gamma){
+  settings.palette.SetScaling(scaling,gamma);
+  img_panel->SetPaletteInfo(&settings.palette);
 }
 
-bool ImageFrame::process_raw_data(){
-  wxMutexLocker lock(*raw_image_data_mutex);
-  if(!raw_image_data){
-    wxLogError(wxT("ImageFrame::process_raw_data raw_image_data = NULL"));
-    return false;
+// Hand the current settings to the processor along with REQUEST, see
+// FrameProcessorRequest.
+void ImageFrame::update_processor(int request){
+  if(processor){
+    processor->Update(settings,request);
   }
+}
 
-  size_t area = width*height;
-
-  // For displaying a regular image, just copy the data over
-  if(!kinetics){
-    //std::copy(*raw_image_data, (*raw_image_data)+area, processed_data);
-    std::transform(*raw_image_data, (*raw_image_data)+area,
-                   processed_data, StaticCaster<long, float>());
-  }
-  // For kinetics mode, need to calculate optical density. Put
-  // calculated OD image into _beginning_ of processed_data.
-  else{
-    size_t subarea = width*(height/n_kinetics);
-    std::fill(processed_data,processed_data+area,0);
-    int idx_dark = 0, idx_shadow = 0, idx_light = 0;
-    if(n_kinetics == 3){
-      idx_dark = 0;
-      idx_shadow = 1;
-      idx_light = 2;
-    }
-    else if(n_kinetics == 2){
-      idx_dark = 0; // no dark picture
-      idx_shadow = 0;
-      idx_light = 1;
-    }
-    else{ // only shadow picture
-      idx_dark = 0;
-      idx_shadow = 0;
-      idx_light = 0;
-    }
-    long* idark = (*raw_image_data) + idx_dark * subarea;
-    long* ishadow = (*raw_image_data) + idx_shadow * subarea;
-    long* ilight = (*raw_image_data) + idx_light * subarea;
-
-    float* od = processed_data;
-    float a=0, b=0;
-
-    if(n_kinetics == 3){
-      for(size_t i=0; i<subarea; ++i){
-        a = std::max(logf(std::max((float)(ilight[i]-idark[i]),0.0f)),-1.0f);
-        b = std::max(logf(std::max((float)(ishadow[i]-idark[i]),0.0f)),-1.0f);
-        od[i] = a-b;
-      }
-    }
-    else if(n_kinetics == 2){
-      for(size_t i=0; i<subarea; ++i){
-        a = std::max(logf(std::max((float)(ilight[i]),0.0f)),-1.0f);
-        b = std::max(logf(std::max((float)(ishadow[i]),0.0f)),-1.0f);
-        od[i] = a-b;
-      }
-    }
-    else{
-      for(size_t i=0; i<subarea; ++i){
-        a = std::max(logf(std::max((float)(ishadow[i]),0.0f)),-1.0f);
-        od[i] = a;
-      }
-    }
+// Area of the data the statistics refer to: the whole frame, or in
+// kinetics mode the first sub image, which holds the OD image.
+wxRect ImageFrame::data_frame() const {
+  if(settings.kinetics){
+    return wxRect(0,0,width,height/settings.n_kinetics);
   }
-  return true;
+  return wxRect(0,0,width,height);
 }
 
-
-void ImageFrame::roi_statistics(const wxRect& roi, std::vector<float>& roi_stat){
-  size_t i=0, j=0, w=roi.width, h=roi.height;
-  float t=0,tmin=0, tmax=0;
-  float m1=0, cmx=0, cmy=0;
-  float* od = processed_data;
-
-  tmin = tmax = od[0];
-  for(j=0; j<h; ++j){
-    for(i=0; i<w; ++i){
-      t = od[(roi.y+j)*width + (roi.x+i)];
-      if(t<tmin){ tmin = t; }
-      if(t>tmax){ tmax = t; }
-      m1 += t;
-      cmx += i*t;
-      cmy += j*t;
-    }
+/*
+  Convert rectangle R in the data frame of the displayed frame into
+  chip coordinates, undoing the binning and readout offset. In
+  kinetics mode, R refers to a single kinetics image.
+ */
+wxRect ImageFrame::data_frame_to_chip(const wxRect& r) const {
+  const Frame& f = view.frame;
+  if(f.GetArea() == 0){
+    return wxRect(0,0,0,0);
   }
-  roi_stat.resize(8);
-  roi_stat[0] = tmin; // minimum
-  roi_stat[1] = tmax; // maximum
-  roi_stat[2] = m1; // integrated
-  roi_stat[3] = width*height>0 ? m1/(width*height) : 0; // mean
-  roi_stat[4] = 0.0;
-  //roi_stat[4] = width*height>1 ? sqrt(m2/(width*height-1)) : 0; // variance
-  roi_stat[5] = 0;
-  roi_stat[6] = cmx / m1; // center of mass x
-  roi_stat[7] = cmy / m1; // center of mass y
+  unsigned int sub_height = f.height / std::max(f.n_images,1u);
+  int y = sub_height ? r.y % sub_height : r.y;
+  int h = std::min((unsigned int)r.height,sub_height-y);
+  return wxRect(f.x0 + r.x*f.hbin,
+                f.y0 + y*f.vbin,
+                r.width*f.hbin,
+                h*f.vbin);
 }
 
 /*
@@ -683,39 +670,28 @@ wxPoint ImageFrame::display_frame_to_data_frame(const wxPoint& p){
 }
 
 
-
-ImageFrame::ImageFrame(wxFrame* parent, const wxString& title,
+ImageFrame::ImageFrame(wxFrame* parent, const wxString& title_,
                        const wxPoint& pos, const wxSize& size,
-                       long** raw_image_data_,
-                       wxMutex* raw_image_data_mutex_,
+                       FrameRing* frame_ring,
                        unsigned int width_, unsigned int height_
                       )
-: wxFrame(parent,-1,title,pos,size),
+: wxFrame(parent,-1,title_,pos,size),
   img_panel(NULL),
   data_panels(0),
-  raw_image_data(raw_image_data_),
-  raw_image_data_mutex(raw_image_data_mutex_),
+  processor(NULL),
+  title(title_),
   width(width_),
   height(height_),
-  processed_data(NULL),
-  processed_image(width,height),
-  disp_image(width,height),
   palette(NULL),
   palette_size(0),
-  palette_min(0),
-  palette_max(0),
-  palette_min_manual(0),
-  palette_max_manual(0),
-  palette_scale_manual(false),
   roi(0,0,width,height),
-  roi_stat(8,0.0f),
-  roi_labels(8,""),
+  readout_roi(0,0,0,0),
+  roi_stat(9,0.0f),
+  roi_labels(9,""),
   display_frame_scale_x(1.0f),
   display_frame_scale_y(1.0f),
   display_frame_tr_x(0),
-  display_frame_tr_y(0),
-  kinetics(false),
-  n_kinetics(3)
+  display_frame_tr_y(0)
 {
   SetBackgroundColour(*wxBLACK);
   //wxLogMessage(wxT("Create ImageFrame(%d,%d)"),width,height);
@@ -727,146 +703,104 @@ ImageFrame::ImageFrame(wxFrame* parent, const wxString& title,
     data_panels[i] = new DataPanel(this,wxNewId(),wxDefaultPosition,wxDefaultSize);
   }
 
-
-  processed_data = new float[width*height];
-  std::fill(processed_data,processed_data+width*height,0);
-
+  settings.roi = roi;
   create_palette();
-  img_panel->SetPaletteInfo(palette,palette_size);
-  const char* lbl[] = {"min","max","tot","mean","varx","vary","cmx","cmy"};
+  img_panel->SetPaletteInfo(&settings.palette);
+  const char* lbl[] = {"min","max","tot","mean","sigx","sigy","cmx","cmy","cov"};
   for(size_t i=0; i<roi_labels.size(); ++i){
     roi_labels[i] = lbl[i];
   }
   img_panel->SetROIStatistics(&roi_stat,&roi_labels);
+  img_panel->SetMarkerStatistics(&marker_stat);
+
+  processor = new FrameProcessor(this,frame_ring);
+  if(processor->Create() != wxTHREAD_NO_ERROR){
+    wxLogError("Cannot create image processing thread!");
+  }
+  processor->Run();
 }
 
 ImageFrame::~ImageFrame(){
-  if(processed_data){
-    delete[] processed_data;
-    processed_data = NULL;
-  }
+  StopProcessing();
   free_palette();
 }
 
-/*
-  This is the meat. When raw_image_data has been updated from the main
-  program, this function is called to update the display.
-
- */
-void ImageFrame::UpdateData(){
-
-  // (A) Convert the raw bytes into floating point representation,
-  //     using OD formula if required.
-
-  if(!process_raw_data()){
+// End the processing thread. The frame ring belongs to the parent
+// frame, so this has to happen before the parent deletes it.
+void ImageFrame::StopProcessing(){
+  if(!processor){
     return;
   }
-
-
-  // (B) The Region Of Interest (ROI) might have changed. Update the
-  //     internal rectangle representing the ROI and calculate
-  //     statistics of the floating point data.
-
-  wxRect total_image(0,0,width,height);
-  if(kinetics){
-    //total_image = wxRect(0,height/n_kinetics,width,height/n_kinetics);
-    total_image = wxRect(0,0,width,height/n_kinetics);
-  }
-  wxRect palroi = total_image;
-  palroi = palroi.Intersect(roi);
-  //wxLogMessage(wxT("totalimg : %d %d %d %d"),total_image.x,total_image.y,
-  //             total_image.width,total_image.height);
-  //wxLogMessage(wxT("palroi : %d %d %d %d"),palroi.x,palroi.y,palroi.width,palroi.height);
-
-  //std::vector<float> roi_tot;
-  //roi_statistics(total_image,roi_tot);
-  roi_statistics(palroi,roi_stat);
-  //wxLogMessage(wxT("Total image [min,max] = [%f, %f]"),roi_tot[0],roi_tot[1]);
-  //wxLogMessage(wxT("ROI [min,max] = [%f, %f]"),roi_stat[0],roi_stat[1]);
-
-
-  // (C) Update the palette information and update the internal RGB
-  //     image from the floating point data. Limit the color
-  //     interpolation to ROI to increase speed.
-
-  if(palette_scale_manual){
-    palette_min = palette_min_manual;
-    palette_max = palette_max_manual;
-  }
-  else if(palette_scale_next_image){
-    palette_min = roi_stat[0]; // ROI min
-    palette_max = roi_stat[1]; // ROI max
-    palette_scale_next_image = false;
-  }
-  img_panel->SetPaletteInfoScale(palette_min,palette_max);
-  //wxLogMessage(wxT("pal : %f, %f"),palette_min,palette_max);
-  //wxLogMessage(wxT("roi_stat: %f %f %f %f %f %f %f %f"),roi_stat[0],
-  //             roi_stat[1],roi_stat[2],roi_stat[3],roi_stat[4],
-  //             roi_stat[5],roi_stat[6],roi_stat[7]);
-
-
-  interpolate_image(processed_data,palette_min,palette_max,
-                    processed_image.GetData(),palette,palette_size,palroi);
-
-  roi = palroi;
-  UpdateDisplay();
+  processor->Quit();
+  processor->Wait();
+  delete processor;
+  processor = NULL;
 }
 
-void ImageFrame::UpdateDisplay(){
-  if(!img_panel){
+/*
+  Have the newest frame of the frame ring processed and shown,
+  skipping all frames that arrived since the last call. Does nothing
+  while the window is hidden or iconized; the frames then stay in the
+  ring, and the newest one gets shown when the window comes back.
+ */
+void ImageFrame::ShowNewestFrame(){
+  if(!IsShown() || IsIconized()){
     return;
   }
+  update_processor(FRAME_PROCESSOR_FRAME);
+}
 
-  // (D) Cut out the ROI from the RGB image, rotate it, rescale it.
-
-  disp_image = processed_image.GetSubImage(roi);
-
-  // update roi -> display scaling factors
-  unsigned int W = img_panel->GetDisplayWidth();
-  unsigned int H = img_panel->GetDisplayHeight();
-  display_frame_scale_x = ((float)W) / roi.width;
-  display_frame_scale_y = ((float)H) / roi.height;
-  float scale = std::min(display_frame_scale_x,display_frame_scale_y);
-  unsigned int w = std::min((unsigned int)(scale * roi.width),W);
-  unsigned int h = std::min((unsigned int)(scale * roi.height),H);
-
-  // rotate by swapping W,H, display_frame_scale_x,y, w,h
-  //std::swap(W,H);
-  //std::swap(display_frame_scale_x,display_frame_scale_y);
-  //std::swap(w,h);
-
-  // update roi -> display translation
-  if(display_frame_scale_x < display_frame_scale_y){
-    display_frame_tr_x = 0;
-    display_frame_tr_y = (H - h) / 2;
-  }
-  else{
-    display_frame_tr_x = (W - w) / 2;
-    display_frame_tr_y = 0;
+/*
+  Show the newest view of the processor. All processing already
+  happened on the processor thread, so this only takes over the
+  statistics and copies the display buffer to the screen. A frame
+  shown for the first time is reported to the parent frame with its
+  shot, see ID_IMAGE_WINDOW_FRAME_SHOWN.
+ */
+void ImageFrame::OnFrameProcessed(wxCommandEvent&){
+  long seq = view.frame.seq;
+  if(!processor || !processor->TakeView(view)){
+    return;
   }
-  wxRect rroi = roi;
-  //std::swap(rroi.x,rroi.y);
-  //std::swap(rroi.width,rroi.height);
-  img_panel->SetDataROI(rroi);
-  img_panel->SetDisplayROI(wxRect(display_frame_tr_x,display_frame_tr_y,w,h));
-
-  // Rotate image
-  disp_image = disp_image.Rotate90();
-
-  // Scale image
-  disp_image.Rescale(w,h);//,wxIMAGE_QUALITY_HIGH);
-
-  // Resize image memory to (W,H) and place original at
-  // (display_frame_tr_x,display_frame_tr_y)
-  disp_image.Resize(wxSize(W,H),wxPoint(display_frame_tr_x,display_frame_tr_y));
-
-
-  // (E) Update display markers with new statistical data
+  const Frame& f = view.frame;
+  if(f.width != width || f.height != height){
+    // The processor already shows the full frame without markers
+    wxLogMessage(wxT("ImageFrame: frame size changed to %d x %d"),f.width,f.height);
+    width = f.width;
+    height = f.height;
+    settings.roi = wxRect(0,0,width,height);
+    settings.marker_rois.clear();
+  }
+
+  roi = view.roi;
+  roi_stat = view.roi_stat;
+  marker_stat = view.marker_stat;
+  display_frame_scale_x = view.scale_x;
+  display_frame_scale_y = view.scale_y;
+  display_frame_tr_x = view.display_roi.x;
+  display_frame_tr_y = view.display_roi.y;
+  img_panel->SetPaletteInfoScale(view.palette_min,view.palette_max);
+  img_panel->SetDataROI(roi);
+  img_panel->SetDisplayROI(view.display_roi);
   UpdateMarkers(roi,roi_stat);
 
-  // (F) Finally update display panel with the ROI RGB image.
+  // A view made for another display size is followed by one for the
+  // current size, see OnResize()
+  wxImage& disp_image = img_panel->GetDisplayImage();
+  if(disp_image.IsOk() && !view.rgb.empty() &&
+     view.display_size == wxSize(disp_image.GetWidth(),disp_image.GetHeight()))
+  {
+    std::copy(view.rgb.begin(),view.rgb.end(),disp_image.GetData());
+    img_panel->UpdateBitmap();
+  }
 
-  img_panel->RecreateBitmap(disp_image);
+  if(f.seq != seq){
+    SetTitle(wxString::Format("%s #%ld",title.c_str(),f.number));
+    wxCommandEvent evt = wxCommandEvent(wxEVT_IMAGE_PANEL,ID_IMAGE_WINDOW_FRAME_SHOWN);
+    evt.SetEventObject(this); // tells the main frame which camera
+    evt.SetExtraLong(f.shot);
+    wxPostEvent(GetParent(),evt);
+  }
 }
 
 
@@ -879,52 +813,118 @@ void ImageFrame::UpdateMarkers(const wxRect& roi, const std::vector<float>& stat
   wxPoint p_data((int)(roi.x + floor(stat[6]+.5)),(int)(roi.y + floor(stat[7]+.5)));
   wxPoint p_disp = data_frame_to_display_frame(p_data);
   img_panel->SetCOMMarker(p_disp);
+
+  // Marker regions, clipped to the displayed ROI
+  const std::vector<wxRect>& marker_rois = view.marker_rois;
+  std::vector<wxRect> markers(marker_rois.size());
+  for(size_t k=0; k<marker_rois.size(); ++k){
+    wxRect r = marker_rois[k];
+    r.Intersect(roi);
+    if(r.IsEmpty()){
+      continue;
+    }
+    wxPoint p1 = data_frame_to_display_frame(wxPoint(r.x,r.y));
+    wxPoint p2 = data_frame_to_display_frame(wxPoint(r.x+r.width,r.y+r.height));
+    markers[k] = wxRect(p1.x,p1.y,p2.x-p1.x,p2.y-p1.y);
+  }
+  img_panel->SetMarkers(markers);
+}
+
+// Convert caret R in display coordinates into a rectangle in the data
+// frame, constrained to the full image.
+wxRect ImageFrame::caret_to_data_frame(const wxRect& r){
+  wxPoint p1(r.x,r.y);
+  wxPoint p2(r.x+r.width,r.y+r.height);
+  wxPoint q1 = display_frame_to_data_frame(p1);
+  wxPoint q2 = display_frame_to_data_frame(p2);
+
+  if(q1.x > q2.x){ std::swap(q1.x,q2.x); }
+  if(q1.y > q2.y){ std::swap(q1.y,q2.y); }
+
+  wxRect d = wxRect(q1,q2);
+
+  // Constrain d to full image
+  if(d.x < 0) {d.width += d.x; d.x = 0;}
+  if(d.y < 0) {d.height += d.y; d.y = 0;}
+  if(d.width > (int)width){d.width = width;}
+  if(d.height > (int)height){d.height = height;}
+  if(d.width < 0){d.width = 0;}
+  if(d.height < 0){d.height = 0;}
+  return d;
 }
 
 /*
   Handle caret selection in ImagePanel here. Convert display frame
   coordinates back into data frame and choose new ROI correspondingly.
+  A caret drawn with control held adds a marker region instead, whose
+  statistics are shown below those of the ROI. A control click
+  removes all marker regions. Either way, the processor takes it from
+  there, and the result shows up with the next view.
  */
 void ImageFrame::OnCaretDone(wxCommandEvent&){
   wxRect r = img_panel->GetCaret();
+  if(img_panel->SelectingMarker()){
+    std::vector<wxRect>& marker_rois = settings.marker_rois;
+    if(r.width == 0 || r.height == 0){
+      marker_rois.clear();
+    }
+    else{
+      wxRect m = caret_to_data_frame(r);
+      m.Intersect(data_frame());
+      if(m.IsEmpty()){
+        wxLogMessage(wxT("Invalid marker region: %d %d %d %d"),m.x,m.y,m.width,m.height);
+        return;
+      }
+      if(marker_rois.size() >= IMAGE_WINDOW_MAX_MARKERS){
+        marker_rois.erase(marker_rois.begin());
+      }
+      marker_rois.push_back(m);
+      wxLogMessage(wxT("New marker region %d: (%d %d %d %d)"),(int)marker_rois.size(),
+                   m.x,m.y,m.width,m.height);
+    }
+    update_processor(FRAME_PROCESSOR_MARKERS);
+    img_panel->ShowCaret(false);
+    img_panel->Refresh();
+    return;
+  }
+  wxRect new_roi;
   if(img_panel->ZoomingIn()){
     if(r.width == 0 || r.height == 0){
       return;
     }
 
-    wxPoint p1(r.x,r.y);
-    wxPoint p2(r.x+r.width,r.y+r.height);
-    wxPoint q1 = display_frame_to_data_frame(p1);
-    wxPoint q2 = display_frame_to_data_frame(p2);
-
-    if(q1.x > q2.x){ std::swap(q1.x,q2.x); }
-    if(q1.y > q2.y){ std::swap(q1.y,q2.y); }
-
-    wxRect r = wxRect(q1,q2);
-
-    // Constrain r to full image
-    if(r.x < 0) {r.width += r.x; r.x = 0;}
-    if(r.y < 0) {r.height += r.y; r.y = 0;}
-    if(r.width > (int)width){r.width = width;}
-    if(r.height > (int)height){r.height = height;}
-    if(r.width < 0){r.width = 0;}
-    if(r.height < 0){r.height = 0;}
+    r = caret_to_data_frame(r);
 
     // Check whether new ROI is empty
     if(r.IsEmpty()){
       wxLogMessage(wxT("Invalid ROI: %d %d %d %d"),r.x,r.y,r.width,r.height);
       return;
     }
-    roi = r;
+    new_roi = r;
   }
   else{
     // zoom to full image for now when zooming out
-    roi = wxRect(0,0,width,height);
+    new_roi = wxRect(0,0,width,height);
+  }
+
+  wxLogMessage(wxT("New ROI: (%d %d %d %d) or ((%d %d) (%d %d))"),
+               new_roi.x,new_roi.y,new_roi.width,new_roi.height,
+               new_roi.x,new_roi.x+new_roi.width,new_roi.y,new_roi.y+new_roi.height);
+  settings.roi = new_roi;
+  update_processor(FRAME_PROCESSOR_DATA);
+
+  // Offer the new ROI to the main frame as camera readout area. Zooming
+  // out asks for the full chip again.
+  if(img_panel->ZoomingIn()){
+    readout_roi = data_frame_to_chip(new_roi.Intersect(data_frame()));
+  }
+  else{
+    readout_roi = wxRect(0,0,0,0);
   }
+  wxCommandEvent evt = wxCommandEvent(wxEVT_IMAGE_PANEL,ID_IMAGE_WINDOW_READOUT_ROI);
+  evt.SetEventObject(this); // tells the main frame which camera
+  wxPostEvent(GetParent(),evt);
 
-  wxLogMessage(wxT("New ROI: (%d %d %d %d) or ((%d %d) (%d %d))"),roi.x,roi.y,roi.width,roi.height,
-               roi.x,roi.x+roi.width,roi.y,roi.y+roi.height);
-  UpdateData();
   img_panel->ShowCaret(false);
   img_panel->Refresh();
 }
@@ -937,7 +937,8 @@ void ImageFrame::OnResize(wxSizeEvent&){
     //wxLogMessage(wxT("ImageFrame::OnResize display_size %d x %d"),wimg,h);
     img_panel->SetSize(0,0,wimg,h);
     img_panel->SetDisplaySize(wimg,h);
-    UpdateDisplay();
+    settings.display_size = wxSize(img_panel->GetDisplayWidth(),img_panel->GetDisplayHeight());
+    update_processor(FRAME_PROCESSOR_DISPLAY);
   }
   for(size_t i=0; i<data_panels.size(); ++i){
     data_panels[i]->SetSize(0,0,(size_t)(1.0/4.0*w),(size_t)((float)h/data_panels.size()));
@@ -945,5 +946,19 @@ void ImageFrame::OnResize(wxSizeEvent&){
   }
 }
 
+void ImageFrame::OnIconize(wxIconizeEvent& evt){
+  if(!evt.Iconized()){
+    ShowNewestFrame();
+  }
+  evt.Skip();
+}
+
+void ImageFrame::OnShow(wxShowEvent& evt){
+  if(evt.GetShow()){
+    ShowNewestFrame();
+  }
+  evt.Skip();
+}
+
 
 // image_window.cc ends here
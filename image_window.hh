@@ -14,13 +14,8 @@
 #include <wx/wx.h>
 #include <vector>
 
-template <typename From, typename To>
-struct StaticCaster {
-    To operator()(const From& x) const {
-      return static_cast<To>(x);
-    }
-};
-
+#include "frame_processor.hh"
+#include "palette_table.hh"
 
 // Helper functions to interpolate floating point data into RGB values
 // using a palette.
@@ -67,6 +62,7 @@ class ImagePanel : public wxPanel {
     size_t display_pad_w; // horizontal padding for display_rect
     size_t display_pad_h; // vertical padding for display_rect
 
+    wxImage display_image; // display pixels, dimension of display_rect, see GetDisplayImage()
     wxBitmap bmp; // holds rgb image data, dimension (display_width x display_height)
     wxMemoryDC bmpdc; // holds img for blitting
 
@@ -80,7 +76,7 @@ class ImagePanel : public wxPanel {
     bool palette_display; // display palette
     float info_palmin; // float value corresponding to palette mininum
     float info_palmax; // float value corresponding to palette maximum
-    unsigned char* info_palette; // pointer to palette color information
+    const PaletteTable* info_palette; // palette colors and scaling
     size_t info_palette_size; // number of colors in palette
     wxMemoryDC palette_mdc; // holds palette gradient bitmap
     wxBitmap palette_bmp; // palette gradient bitmap
@@ -99,6 +95,10 @@ class ImagePanel : public wxPanel {
     bool com_display; // show center of mass marker?
     wxPoint com; // marker position _in_display_coordinates_
 
+    bool marker_display; // show marker regions?
+    std::vector<wxRect> markers; // marker regions _in_display_coordinates_, empty when not visible
+    std::vector<std::vector<float> >* marker_stat; // statistics of each marker region
+
     bool statistics_display; // show ROI statistics?
     std::vector<float>* roi_stat; // statistics vector
     std::vector<wxString>* roi_labels; // labels for statistics vector
@@ -108,6 +108,8 @@ class ImagePanel : public wxPanel {
     void draw_axes(wxDC& dc);
     void draw_palette_info(wxDC& dc);
     void draw_statistics_info(wxDC& dc);
+    size_t draw_statistics_line(wxDC& dc, const wxString& prefix,
+                                const std::vector<float>& stat, size_t first, size_t y0);
 
   public:
     ImagePanel(wxFrame* parent,
@@ -122,7 +124,7 @@ class ImagePanel : public wxPanel {
     void SetDataROI(const wxRect& roi){ info_data_roi = roi; }
     void SetDisplayROI(const wxRect& roi){ info_display_roi = roi;}
 
-    void SetPaletteInfo(unsigned char* p, size_t size);
+    void SetPaletteInfo(const PaletteTable* p);
     void SetPaletteInfoScale(float palmin, float palmax){
       info_palmin = palmin;
       info_palmax = palmax;
@@ -137,6 +139,12 @@ class ImagePanel : public wxPanel {
       roi_labels = roi_labels_;
     }
 
+    void SetMarkers(const std::vector<wxRect>& m);
+    // Statistics of the marker regions, without minimum and maximum
+    void SetMarkerStatistics(std::vector<std::vector<float> >* marker_stat_){
+      marker_stat = marker_stat_;
+    }
+
     void OnPaint(wxPaintEvent&);
 
     // Empty. Do not erase background since OnPaint always draws the
@@ -146,12 +154,18 @@ class ImagePanel : public wxPanel {
     void RecreateBitmap(const wxImage& new_image);
     void FreeBitmap();
 
+    // Persistent RGB buffer of GetDisplayWidth() x GetDisplayHeight()
+    // pixels. Write the display into it, then call UpdateBitmap().
+    wxImage& GetDisplayImage(){ return display_image; }
+    void UpdateBitmap(){ RecreateBitmap(display_image); }
+
     void OnMouseLeftDown(wxMouseEvent& evt);
     void OnMouseLeftUp(wxMouseEvent& evt);
     void OnMouseMove(wxMouseEvent& evt);
     const wxRect& GetCaret() const {return caret_final;}
     void ShowCaret(bool show){caret_display = show;}
     const bool ZoomingIn() const {return zoom_in;}
+    const bool SelectingMarker() const {return select_marker;}
 
 
     DECLARE_EVENT_TABLE()
@@ -183,7 +197,9 @@ class DataPanel : public wxPanel {
 
 /*
   A wxFrame based class for displaying integer image data in false
-  color.
+  color. The frames are processed by a FrameProcessor on its own
+  thread, the window only takes over the finished views and handles
+  user interaction.
 
  */
 class ImageFrame : public wxFrame {
@@ -195,42 +211,34 @@ class ImageFrame : public wxFrame {
     // data panels for time series of statistical data
     std::vector<DataPanel*> data_panels;
 
-    long** raw_image_data; // pointer to raw integer image data
-    wxMutex* raw_image_data_mutex; // raw data needs mutex protected access!
-    unsigned int width; // image data width
-    unsigned int height; // image data height
-
-    float* processed_data; // integer data -> processed floating point data
-    wxImage processed_image; // processed floating point data -> rgb image data
-    wxImage disp_image; // cropped, rotated, rescaled sub image of processed_image for display
+    FrameProcessor* processor; // processes the frames off the GUI thread
+    wxString title; // window title, followed by the image number
+    unsigned int width; // image data width, follows the frame size
+    unsigned int height; // image data height, follows the frame size
 
     unsigned char* palette; // palette color information
     size_t palette_size; // number of colors in palette
-    float palette_min; // floating point value corresponding to palette minimum
-    float palette_max; // floating point value corresponding to palette maximum
-    float palette_min_manual; // manual setting for palette minimum
-    float palette_max_manual; // manual setting for palette maximum
-    bool palette_scale_manual; // use manual palette scale?
-    bool palette_scale_next_image; // autoscale palette to next image?
-
-    wxRect roi; // Region Of Interest rectangle
+
+    FrameSettings settings; // how frames are processed, requested ROI and markers
+    FrameView view; // processed frame currently displayed
+
+    wxRect roi; // Region Of Interest rectangle currently displayed
+    wxRect readout_roi; // ROI in chip coordinates, empty for full chip
     std::vector<float> roi_stat; // ROI statistics
     std::vector<wxString> roi_labels; // ROI statistics labels
+    std::vector<std::vector<float> > marker_stat; // statistics of the marker regions
     float display_frame_scale_x; // X scaling factor between data and display frames
     float display_frame_scale_y; // Y scaling factor between data and display frames
     int display_frame_tr_x; // X translation to center data in display frame
     int display_frame_tr_y; // Y translation to center data in display frame
 
-    bool kinetics; // using kinetics mode?
-    unsigned int n_kinetics; // number of kinetics sub images
-
 
     void free_palette();
     void create_palette();
-    void interpolate_image(float* t, float t0, float t1, unsigned char* rgb,
-                           unsigned char* pal, size_t npal, const wxRect& palroi);
-    bool process_raw_data();
-    void roi_statistics(const wxRect& roi, std::vector<float>& roi_stat);
+    void update_processor(int request);
+    wxRect data_frame_to_chip(const wxRect& r) const;
+    wxRect data_frame() const;
+    wxRect caret_to_data_frame(const wxRect& r);
     wxPoint data_frame_to_display_frame(const wxPoint& p);
     wxPoint display_frame_to_data_frame(const wxPoint& p);
 
@@ -239,29 +247,43 @@ class ImageFrame : public wxFrame {
                const wxString& title,
                const wxPoint& pos,
                const wxSize& size,
-               long** raw_image_data_,
-               wxMutex* raw_image_data_mutex_,
+               FrameRing* frame_ring,
                unsigned int width_,
                unsigned int height_
               );
 
     ~ImageFrame();
 
-    void UpdateData();
-    void UpdateDisplay();
+    void StopProcessing();
+    void ShowNewestFrame();
     void UpdateMarkers(const wxRect& roi, const std::vector<float>& stat);
     void OnCaretDone(wxCommandEvent&);
+    void OnFrameProcessed(wxCommandEvent&);
     void OnResize(wxSizeEvent&);
+    void OnIconize(wxIconizeEvent& evt);
+    void OnShow(wxShowEvent& evt);
 
-
+    // The setters below apply from the next frame or ROI change on
     void SetKinetics(bool kinetics_on, unsigned int n_kinetics_=1){
-      kinetics = kinetics_on; n_kinetics = n_kinetics_;
+      settings.kinetics = kinetics_on; settings.n_kinetics = n_kinetics_;
     }
-    void SetScaleManual(bool scaleq) {palette_scale_manual = scaleq;}
-    bool GetScaleManual() const {return palette_scale_manual;}
-    void SetScaleNextImage() {palette_scale_next_image = true;}
-    void SetScaleMin(float tmin) {palette_min_manual = tmin;}
-    void SetScaleMax(float tmax) {palette_max_manual = tmax;}
+    // Number of image processing threads, 0 for one per core
+    void SetProcessingThreads(size_t n){processor->SetThreadCount(n);}
+    size_t GetProcessingThreads() const {return processor->GetThreadCount();}
+    void SetScaleManual(bool scaleq) {settings.palette_scale_manual = scaleq;}
+    bool GetScaleManual() const {return settings.palette_scale_manual;}
+    void SetScaleNextImage() {processor->ScaleNextImage();}
+    void SetScaleMin(float tmin) {settings.palette_min_manual = tmin;}
+    void SetScaleMax(float tmax) {settings.palette_max_manual = tmax;}
+    void SetPaletteScaling(PaletteScaling scaling, float gamma=1.0f);
+    PaletteScaling GetPaletteScaling() const {return settings.palette.GetScaling();}
+    void SetResampling(ResampleMode mode){settings.resampling = mode;}
+    ResampleMode GetResampling() const {return settings.resampling;}
+
+    // Chip area corresponding to the last ROI selection, see
+    // ID_IMAGE_WINDOW_READOUT_ROI. Zero width and height select the
+    // full chip.
+    const wxRect& GetReadoutROI() const {return readout_roi;}
 
     DECLARE_EVENT_TABLE()
 
@@ -0,0 +1,99 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 16:41:12 sb"
+
+/*
+  file       image_writer.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "image_writer.hh"
+#include "camera_worker.hh"
+#include "frame_ring.hh"
+#include "shot_timeline.hh"
+#include "tiff_writer.hh"
+
+#include <sstream>
+
+
+ImageWriterWorker::ImageWriterWorker(CameraWorker* owner_, FrameRing* frame_ring_,
+                                     ShotTimeline* timeline_)
+  : wxThread(wxTHREAD_JOINABLE),
+    owner(owner_),
+    frame_ring(frame_ring_),
+    timeline(timeline_),
+    condition(mutex),
+    pending(0),
+    quit(false),
+    failed(0)
+{
+}
+
+void* ImageWriterWorker::Entry(){
+  std::ostringstream os;
+  while(true){
+    Job job;
+    {
+      wxMutexLocker lock(mutex);
+      while(jobs.empty() && !quit){
+        condition.Wait();
+      }
+      if(jobs.empty()){
+        break;
+      }
+      job = jobs.front();
+      jobs.pop();
+    }
+
+    timeline->Stamp(job.shot,SHOT_SAVE_BEGIN);
+    bool ok = write_frame_tiff(job.path,*job.frame);
+    size_t n_images = job.frame->n_images;
+    frame_ring->Release(job.frame);
+    timeline->Stamp(job.shot,SHOT_SAVE_END);
+
+    if(ok){
+      os << "Image -> \"" << job.path << "\"";
+      owner->log_message(os.str()); os.str("");
+      owner->signal_image_saved(n_images,job.path);
+    }
+    else{
+      os << "Failed saving image to \"" << job.path << "\"";
+      owner->log_error(os.str()); os.str("");
+      atomic_set(&failed,1);
+    }
+
+    {
+      wxMutexLocker lock(mutex);
+      --pending;
+      condition.Broadcast();
+    }
+  }
+  return NULL;
+}
+
+void ImageWriterWorker::Write(Frame* frame, const std::string& path, long shot){
+  Job job;
+  job.frame = frame;
+  job.path = path;
+  job.shot = shot;
+  wxMutexLocker lock(mutex);
+  jobs.push(job);
+  ++pending;
+  condition.Broadcast();
+}
+
+void ImageWriterWorker::Flush(){
+  wxMutexLocker lock(mutex);
+  while(pending){
+    condition.Wait();
+  }
+}
+
+void ImageWriterWorker::Quit(){
+  wxMutexLocker lock(mutex);
+  quit = true;
+  condition.Broadcast();
+}
+
+
+// image_writer.cc ends here
@@ -0,0 +1,79 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 16:20:48 sb"
+
+/*
+  file       image_writer.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef IMAGE_WRITER_HH
+#define IMAGE_WRITER_HH
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <queue>
+#include <string>
+
+#include "atomic_ops.hh"
+
+class CameraWorker;
+class Frame;
+class FrameRing;
+class ShotTimeline;
+
+/*
+  Writes downloaded frames to disk on its own thread, so that the
+  acquisition loop only ever waits for the camera. Write() takes over
+  a reference to a frame slot published with FrameRing::EndWrite(frame,
+  true) and the writer releases it once the TIFF files are written.
+  Every written image is reported to the owner, which forwards it to
+  the file sorter. Write errors are logged and latched, see
+  HasFailed().
+
+  The number of queued frames is bounded by the frame ring: while the
+  writer holds every free slot, the owner has to save synchronously.
+ */
+class ImageWriterWorker : public wxThread {
+  private:
+    struct Job {
+      Frame* frame;
+      std::string path;
+      long shot;
+    };
+
+    CameraWorker* owner;
+    FrameRing* frame_ring;
+    ShotTimeline* timeline;
+
+    wxMutex mutex; // protects jobs, pending and quit
+    wxCondition condition; // signaled on new jobs, finished jobs and quit
+    std::queue<Job> jobs;
+    size_t pending; // jobs queued or being written
+    bool quit;
+    atomic_long_t failed;
+
+    ImageWriterWorker(const ImageWriterWorker&) : condition(mutex) {}
+
+  public:
+    ImageWriterWorker(CameraWorker* owner_, FrameRing* frame_ring_,
+                      ShotTimeline* timeline_);
+
+    virtual void* Entry();
+
+    // Queue FRAME for writing to PATH. Called from the camera thread.
+    void Write(Frame* frame, const std::string& path, long shot);
+    // Block until every queued frame is written.
+    void Flush();
+    // Write the remaining frames, then end the thread.
+    void Quit();
+
+    bool HasFailed() {return atomic_get(&failed) != 0;}
+    void ClearFailed() {atomic_set(&failed,0);}
+};
+
+
+#endif // IMAGE_WRITER_HH
+
+// image_writer.hh ends here
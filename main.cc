@@ -12,16 +12,26 @@
 #include <wx/log.h>
 #include <wx/thread.h>
 #include <wx/aboutdlg.h>
+#include <wx/filedlg.h>
+#include <wx/filename.h>
 #include <iostream>
 #include <queue>
 #include <string>
 #include <map>
+#include <vector>
 
 #include "gui_ids.hh"
 #include "image_window.hh"
 #include "camera_worker.hh"
 #include "camera_control.hh"
 #include "file_sorter.hh"
+#include "frame_ring.hh"
+#include "shot_timeline.hh"
+#include "telemetry.hh"
+#include "telemetry_plot.hh"
+#include "monotonic_clock.hh"
+#include "andor_driver.hh"
+#include "od_kernels.hh"
 
 #define PROGRAM  "Sr Imaging"
 #define VERSION  "20121002"
@@ -42,11 +52,18 @@
 #define IMAGE_FRAME_WIDTH       1033
 #define IMAGE_FRAME_HEIGHT      1050
 
+// Offset of the image frames of further cameras
+#define IMAGE_FRAME_CASCADE     40
+
 // do not change this for now
 #define IMAGE_WIDTH  1024
 #define IMAGE_HEIGHT 1024
 
-#define TEMPERATURE_TIMER_PERIOD_MS 5000
+// Period of status bar and telemetry plot updates
+#define TELEMETRY_DISPLAY_PERIOD_MS 1000
+
+// Minimum time between updates of the shot timeline in the status bar
+#define SHOT_TIMELINE_STATUS_PERIOD_MS 1000
 
 // ---------------------------------------------------------------------- Classes
 
@@ -62,36 +79,65 @@ IMPLEMENT_APP(SRIApp)
 
 typedef std::map<std::string,wxControl*> control_map_t;
 
+/*
+  Everything that belongs to one camera. Each camera has its own
+  worker thread, frame buffers, shot timeline and image frame, so
+  that cameras acquire, download and save independently.
+ */
+class CameraUnit {
+  public:
+    int index;
+    CameraWorker* worker;
+    bool active;
+    camera_channel_t commands;
+    FrameRing frame_ring;
+    ShotTimeline timeline;
+    TelemetryRing telemetry;
+    double timeline_status_ms; // last status bar update
+    CameraExperimentControl control;
+    wxMutex control_mutex;
+    ImageFrame* img_frame;
+    bool sorter_overflow; // images could not be queued for sorting
+
+    CameraUnit(int index_)
+      : index(index_),
+        worker(NULL),
+        active(false),
+        commands(CAMERA_COMMAND_CAPACITY),
+        timeline_status_ms(0),
+        img_frame(NULL),
+        sorter_overflow(false)
+    {}
+  private:
+    CameraUnit(const CameraUnit&) : commands(0) {}
+};
+
+typedef std::vector<CameraUnit*> camera_units_t;
+
 class SRIMainFrame : public wxFrame{
   private:
-    CameraWorker* camera;
-    bool camera_active;
+    camera_units_t cameras;
     message_queue_t message_queue;
-    message_queue_t camera_command_queue;
     wxMutex message_queue_mutex;
-    wxMutex camera_command_queue_mutex;
-    long* raw_image_data;
-    wxMutex raw_image_data_mutex;
-    CameraExperimentControl experiment_control;
-    wxMutex experiment_control_mutex;
+    CameraExperimentControl experiment_control; // as entered in the controls
+    int readout_camera; // camera the readout area controls belong to, -1 for all
     FileSorterWorker* sorter;
     bool sorter_active;
-    message_queue_t sorter_command_queue;
-    wxMutex sorter_command_queue_mutex;
+    file_sorter_channel_t sorter_commands;
     std::string sorter_target_directory;
 
     wxNotebook* tab_ctrl;
     wxLogTextCtrl* log;
-    ImageFrame* img_frame;
+    TelemetryPlot* telemetry_plot;
     control_map_t control_map;
 
-    wxTimer temperature_timer;
+    wxTimer telemetry_timer;
 
   public:
     SRIMainFrame(const wxString& title, const wxPoint& pos, const wxSize& size);
     ~SRIMainFrame();
 
-    void StartCameraWorker();
+    void StartCameraWorkers(bool simulate_camera, int n_cameras, int processing_threads);
     void StartFileSorterWorker();
 
     void OnQuit(wxCommandEvent&);
@@ -108,10 +154,14 @@ class SRIMainFrame : public wxFrame{
     void OnCameraExperimentEnd(wxCommandEvent& evt);
     void OnCameraData(wxCommandEvent& evt);
     void OnCameraImageReady(wxCommandEvent& evt);
+    void OnCameraImageSaved(wxCommandEvent& evt);
+    void OnSaveShotTimeline(wxCommandEvent&);
 
     void OnChangeInterruptField(wxCommandEvent&);
+    void OnImageReadoutROI(wxCommandEvent&);
+    void OnImageFrameShown(wxCommandEvent& evt);
 
-    void OnTemperatureTimer(wxTimerEvent&);
+    void OnTelemetryTimer(wxTimerEvent&);
 
     void OnFileSorterWorkerDone(wxCommandEvent&);
 
@@ -120,9 +170,14 @@ class SRIMainFrame : public wxFrame{
   private:
     wxPanel* CreateMainPanel();
     wxPanel* CreateSetupPanel();
-    void dispatch_camera_command(const std::string& cmd);
-    void dispatch_filesorter_command(const std::string& cmd);
+    CameraUnit* find_camera(long index);
+    bool any_camera_active() const;
+    void dispatch_camera_command(CameraCommandType type);
+    void dispatch_camera_command(CameraUnit* unit, CameraCommandType type);
+    void interrupt_camera_waits();
+    bool dispatch_filesorter_command(const FileSorterCommand& cmd);
     void read_back_data_from_controls();
+    void apply_controls(CameraUnit* unit, bool readout);
 
 
     DECLARE_EVENT_TABLE()
@@ -140,12 +195,16 @@ EVT_MENU(ID_CAMERA_WORKER_DONE, SRIMainFrame::OnCameraWorkerDone)
 EVT_MENU(ID_CAMERA_EXPERIMENT_BEGIN, SRIMainFrame::OnCameraExperimentBegin)
 EVT_MENU(ID_CAMERA_EXPERIMENT_END, SRIMainFrame::OnCameraExperimentEnd)
 EVT_MENU(ID_CAMERA_IMAGE_READY, SRIMainFrame::OnCameraImageReady)
+EVT_MENU(ID_CAMERA_IMAGE_SAVED, SRIMainFrame::OnCameraImageSaved)
+EVT_MENU(ID_SAVE_SHOT_TIMELINE, SRIMainFrame::OnSaveShotTimeline)
 EVT_COMMAND(ID_CAMERA_WORKER, wxEVT_CAMERA_DATA, SRIMainFrame::OnCameraData)
-EVT_TIMER(ID_TEMPERATURE_TIMER,SRIMainFrame::OnTemperatureTimer)
+EVT_TIMER(ID_TELEMETRY_TIMER,SRIMainFrame::OnTelemetryTimer)
 EVT_BUTTON(ID_CMD_BEGIN_EXPERIMENT,SRIMainFrame::OnCmdBeginExperiment)
 EVT_BUTTON(ID_CMD_ABORT_EXPERIMENT,SRIMainFrame::OnCmdAbortExperiment)
 EVT_BUTTON(ID_CMD_SCALE_NEXT_IMAGE,SRIMainFrame::OnCmdScaleNextImage)
 EVT_MENU(ID_FILE_SORTER_WORKER_DONE, SRIMainFrame::OnFileSorterWorkerDone)
+EVT_COMMAND(ID_IMAGE_WINDOW_READOUT_ROI, wxEVT_IMAGE_PANEL, SRIMainFrame::OnImageReadoutROI)
+EVT_COMMAND(ID_IMAGE_WINDOW_FRAME_SHOWN, wxEVT_IMAGE_PANEL, SRIMainFrame::OnImageFrameShown)
 EVT_MENU(ID_ABOUT, SRIMainFrame::OnAbout)
 END_EVENT_TABLE()
 
@@ -158,7 +217,44 @@ bool SRIApp::OnInit(){
   frame = new SRIMainFrame(wxString(PROGRAM)+_(" version ")+wxString(VERSION),
                            wxPoint(MAIN_FRAME_X_POSITION, MAIN_FRAME_Y_POSITION),
                            wxSize(MAIN_FRAME_WIDTH, MAIN_FRAME_HEIGHT));
-  frame->StartCameraWorker();
+  // --simulate runs on the simulated camera instead of the hardware,
+  // --cameras N overrides the number of cameras found,
+  // --od-kernel NAME forces an optical density kernel (scalar, avx2),
+  // --processing-threads N sets the image processing threads per
+  // image window, 0 for one per core
+  bool simulate_camera = false;
+  long n_cameras = 0;
+  long processing_threads = BAND_POOL_THREADS;
+  wxString od_kernel;
+  for(int i=1; i<argc; ++i){
+    if(wxString(argv[i]) == "--simulate"){
+      simulate_camera = true;
+    }
+    else if(wxString(argv[i]) == "--cameras" && i+1 < argc){
+      wxString(argv[++i]).ToLong(&n_cameras);
+    }
+    else if(wxString(argv[i]) == "--processing-threads" && i+1 < argc){
+      wxString(argv[++i]).ToLong(&processing_threads);
+    }
+    else if(wxString(argv[i]) == "--od-kernel" && i+1 < argc){
+      od_kernel = argv[++i];
+    }
+  }
+  if(!od_kernel.IsEmpty()){
+    int k = 0;
+    while(k < OD_KERNELS && od_kernel != od_kernel_name((OdKernel)k)){
+      ++k;
+    }
+    if(!od_set_kernel((OdKernel)k)){
+      wxLogError("Optical density kernel %s not supported",od_kernel.c_str());
+    }
+  }
+  wxLogMessage("Using %s optical density kernel",od_kernel_name(od_get_kernel()));
+  if(n_cameras <= 0){
+    n_cameras = andor_available_cameras(simulate_camera);
+  }
+  frame->StartCameraWorkers(simulate_camera,n_cameras > 0 ? (int)n_cameras : 1,
+                            processing_threads > 0 ? (int)processing_threads : 0);
   frame->StartFileSorterWorker();
   return true;
 }
@@ -170,18 +266,18 @@ SRIMainFrame::SRIMainFrame(const wxString& title,
                            const wxPoint& pos,
                            const wxSize& size)
   : wxFrame(NULL,-1,title,pos,size),
-    camera(NULL),
-    camera_active(false),
-    raw_image_data(NULL),
+    readout_camera(-1),
+    sorter_active(false),
+    sorter_commands(FILE_SORTER_COMMAND_CAPACITY),
+    sorter_target_directory(FILE_SORTER_TARGET_DIRECTORY),
     tab_ctrl(NULL),
     log(NULL),
-    img_frame(NULL),
-    temperature_timer(this,ID_TEMPERATURE_TIMER),
-    sorter_active(false),
-    sorter_target_directory(FILE_SORTER_TARGET_DIRECTORY)
+    telemetry_plot(NULL),
+    telemetry_timer(this,ID_TELEMETRY_TIMER)
 {
   // Create a menu
   wxMenu* m = new wxMenu;
+  m->Append(ID_SAVE_SHOT_TIMELINE, _("Save shot &timeline..."));
   m->AppendSeparator();
   m->Append(ID_QUIT, _("E&xit"));
   wxMenu* m2 = new wxMenu;
@@ -201,28 +297,25 @@ SRIMainFrame::SRIMainFrame(const wxString& title,
   tab_ctrl = new wxNotebook(this,wxID_ANY);
   tab_ctrl->AddPage(CreateMainPanel(),"Main",true);
   tab_ctrl->AddPage(CreateSetupPanel(),"Setup",false);
+  telemetry_plot = new TelemetryPlot(tab_ctrl,wxID_ANY);
+  tab_ctrl->AddPage(telemetry_plot,"Telemetry",false);
 
   Show(true);
 
   wxLogMessage(_("%s version %s, %s"), PROGRAM, VERSION, COPY);
-
-  // Setup image frame
-  img_frame = new ImageFrame(this, _("Image"),
-                             wxPoint(IMAGE_FRAME_X_POSITION, IMAGE_FRAME_Y_POSITION),
-                             wxSize(IMAGE_FRAME_WIDTH,IMAGE_FRAME_HEIGHT),
-                             &raw_image_data, &raw_image_data_mutex,
-                             IMAGE_WIDTH, IMAGE_HEIGHT);
-  img_frame->Show(true);
 }
 
+// The image frames are children of the main frame and get destroyed
+// with it, but their processing threads use the frame rings and have
+// to end first.
 SRIMainFrame::~SRIMainFrame(){
-  {
-    wxMutexLocker lock(raw_image_data_mutex);
-    if(raw_image_data){
-      delete[] raw_image_data;
-      raw_image_data = NULL;
+  for(size_t k=0; k<cameras.size(); ++k){
+    if(cameras[k]->img_frame){
+      cameras[k]->img_frame->StopProcessing();
     }
+    delete cameras[k];
   }
+  cameras.clear();
 }
 
 
@@ -241,12 +334,19 @@ wxPanel* SRIMainFrame::CreateMainPanel(){
   const char* labels[] = {"bool","scale_manual","Manual scale?","false","true",
                           "text","scale_min","Scale min","0","true",
                           "text","scale_max","Scale max","1","true",
+                          "text","palette_scaling","Palette scaling (linear, log, gamma)","linear","true",
+                          "text","palette_gamma","Palette gamma","0.5","true",
+                          "text","display_resampling","Display resampling (nearest, bilinear)","nearest","true",
                           "bool","kinetics_mode","Kinetics mode?","true","false",
                           "bool","process_kinetics","Process kinetics?","false","true",
                           "bool","internal_trigger","Internal Trigger?","false","false",
-                          "bool","save_images","Save Images?","false","true"
+                          "bool","save_images","Save Images?","false","true",
+                          "bool","blocking_wait","Blocking wait?","true","false",
+                          "bool","pipelined","Pipelined re-arm?","true","false",
+                          "bool","streaming","Streaming mode?","false","false",
+                          "bool","lock_readout_to_roi","Lock readout to ROI?","false","true"
     };
-  size_t nlabels = 7;
+  size_t nlabels = 14;
   size_t nfields = 5;
   for(size_t i=0; i<nlabels; ++i){
     wxStaticText* lbl =  new wxStaticText(p,wxNewId(),
@@ -310,9 +410,16 @@ wxPanel* SRIMainFrame::CreateSetupPanel(){
   setting_sizer->AddGrowableCol(3);
   const char* labels[] = {"exposure_time","Exposure time (ms)","0.05",
                           "number_kinetics","Number of kinetics images", "3",
-                          "image_spool_path","Image spool directory",IMAGE_SPOOL_PATH
+                          "image_spool_path","Image spool directory",IMAGE_SPOOL_PATH,
+                          "trigger_period","Trigger period (ms, 0 = unknown)","0",
+                          "readout_x","Readout x (px)","0",
+                          "readout_y","Readout y (px)","0",
+                          "readout_width","Readout width (px, 0 = full)","0",
+                          "readout_height","Readout height (px, 0 = full)","0",
+                          "hbin","Horizontal binning","1",
+                          "vbin","Vertical binning","1"
     };
-  size_t nlabels = 3;
+  size_t nlabels = 10;
   for(size_t i=0; i<nlabels; ++i){
     wxStaticText* lbl = new wxStaticText(p,wxNewId(),labels[3*i+1]+wxString(": "));
     wxTextCtrl* cmd = new wxTextCtrl(p,wxNewId(),labels[3*i+2]);
@@ -348,27 +455,60 @@ void SRIMainFrame::OnNewChildError(wxCommandEvent&){
 }
 
 
-void SRIMainFrame::StartCameraWorker(){
-  // Camera worker thread
-  camera = new CameraWorker(this,&message_queue,&camera_command_queue,
-                            &message_queue_mutex,&camera_command_queue_mutex,
-                            &raw_image_data,&raw_image_data_mutex,
-                            &experiment_control,&experiment_control_mutex
-                           );
-  if(camera->Create() != wxTHREAD_NO_ERROR){
-    wxLogError("Cannot create camera worker thread!");
+// Start one worker thread with its own image frame for each of the
+// N_CAMERAS cameras. Each image frame processes images with
+// PROCESSING_THREADS threads, 0 for one per core.
+void SRIMainFrame::StartCameraWorkers(bool simulate_camera, int n_cameras,
+                                      int processing_threads)
+{
+  if(simulate_camera){
+    wxLogMessage("Using simulated camera");
+  }
+  wxLogMessage("Starting %d camera worker(s)",n_cameras);
+  for(int k=0; k<n_cameras; ++k){
+    CameraUnit* u = new CameraUnit(k);
+    cameras.push_back(u);
+
+    wxString title = _("Image");
+    std::string log_prefix;
+    if(n_cameras > 1){
+      title = wxString::Format(_("Image camera %d"),k);
+      log_prefix = wxString::Format("Camera %d: ",k).c_str();
+    }
+    u->img_frame = new ImageFrame(this, title,
+                                  wxPoint(IMAGE_FRAME_X_POSITION + k*IMAGE_FRAME_CASCADE,
+                                          IMAGE_FRAME_Y_POSITION + k*IMAGE_FRAME_CASCADE),
+                                  wxSize(IMAGE_FRAME_WIDTH,IMAGE_FRAME_HEIGHT),
+                                  &u->frame_ring,
+                                  IMAGE_WIDTH, IMAGE_HEIGHT);
+    u->img_frame->SetProcessingThreads(processing_threads);
+    if(k == 0){
+      wxLogMessage("Processing images with %d thread(s) per window",
+                   (int)u->img_frame->GetProcessingThreads());
+    }
+    u->img_frame->Show(true);
+    telemetry_plot->AddSeries(&u->telemetry,wxString::Format("Camera %d",k));
+
+    u->worker = new CameraWorker(this,&message_queue,&message_queue_mutex,
+                                 &u->commands,
+                                 &u->frame_ring,&u->timeline,&u->telemetry,
+                                 &u->control,&u->control_mutex,
+                                 simulate_camera,k,log_prefix
+                                );
+    if(u->worker->Create() != wxTHREAD_NO_ERROR){
+      wxLogError("Cannot create camera worker thread %d!",k);
+      continue;
+    }
+    u->worker->Run();
+    u->active = true;
   }
-  camera->Run();
-  camera_active = true;
-  // start temperature timer
-  temperature_timer.Start(TEMPERATURE_TIMER_PERIOD_MS);
-  wxLogMessage("Temperature timer started");
+  telemetry_timer.Start(TELEMETRY_DISPLAY_PERIOD_MS);
 }
 
 void SRIMainFrame::StartFileSorterWorker(){
   // File sorter worker thread
   sorter = new FileSorterWorker(this,&message_queue,&message_queue_mutex,
-                                &sorter_command_queue,&sorter_command_queue_mutex,
+                                &sorter_commands,
                                 sorter_target_directory
                                );
   if(sorter->Create() != wxTHREAD_NO_ERROR){
@@ -379,83 +519,151 @@ void SRIMainFrame::StartFileSorterWorker(){
 }
 
 void SRIMainFrame::OnQuit(wxCommandEvent&){
-  if(camera_active){
-    dispatch_camera_command("QUIT");
-  }
+  dispatch_camera_command(CAMERA_CMD_QUIT);
+  interrupt_camera_waits();
   if(sorter_active){
-    dispatch_filesorter_command("QUIT");
+    dispatch_filesorter_command(FileSorterCommand(FILE_SORTER_CMD_QUIT));
   }
-  if(!camera_active && !sorter_active){
+  if(!any_camera_active() && !sorter_active){
     Close(true);
   }
 }
 
 void SRIMainFrame::OnClose(wxCloseEvent&){
-  if(camera_active){
-    dispatch_camera_command("QUIT");
-  }
+  dispatch_camera_command(CAMERA_CMD_QUIT);
+  interrupt_camera_waits();
   if(sorter_active){
-    dispatch_filesorter_command("QUIT");
+    dispatch_filesorter_command(FileSorterCommand(FILE_SORTER_CMD_QUIT));
   }
-  if(!camera_active && !sorter_active){
+  if(!any_camera_active() && !sorter_active){
     Destroy();
   }
 }
 
+// The readout area controls only go to the camera they were last
+// locked to, see OnImageReadoutROI(), so that the other cameras keep
+// their own readout areas.
 void SRIMainFrame::OnCmdBeginExperiment(wxCommandEvent&){
   read_back_data_from_controls();
-  // autoscale to initial picture
-  img_frame->SetScaleNextImage();
-  dispatch_camera_command("START");
+  for(size_t k=0; k<cameras.size(); ++k){
+    apply_controls(cameras[k],readout_camera < 0 || cameras[k]->index == readout_camera);
+    // autoscale to initial picture
+    cameras[k]->img_frame->SetScaleNextImage();
+  }
+  dispatch_camera_command(CAMERA_CMD_START);
 }
 
 void SRIMainFrame::OnCmdAbortExperiment(wxCommandEvent&){
-  dispatch_camera_command("INT:ABORT");
+  dispatch_camera_command(CAMERA_CMD_ABORT);
+  interrupt_camera_waits();
 }
 
 void SRIMainFrame::OnCmdScaleNextImage(wxCommandEvent&){
-  if(img_frame){
-    wxLogMessage("Autoscaling to next Image.");
-    img_frame->SetScaleNextImage();
+  wxLogMessage("Autoscaling to next Image.");
+  for(size_t k=0; k<cameras.size(); ++k){
+    cameras[k]->img_frame->SetScaleNextImage();
   }
 }
 
 
-void SRIMainFrame::OnCameraWorkerDone(wxCommandEvent&){
-  camera_active = false;
-  wxLogMessage("Camera worker thread finished");
-  // stop temperature timer
-  temperature_timer.Stop();
-  wxLogMessage("Temperature timer stopped");
-  wxCommandEvent evt(wxEVT_COMMAND_MENU_SELECTED,ID_QUIT);
-  wxPostEvent(this,evt);
+// Quit once the last camera worker finished
+void SRIMainFrame::OnCameraWorkerDone(wxCommandEvent& evt){
+  CameraUnit* u = find_camera(evt.GetExtraLong());
+  if(!u){
+    return;
+  }
+  u->active = false;
+  wxLogMessage("Camera worker thread %d finished",u->index);
+  if(any_camera_active()){
+    return;
+  }
+  telemetry_timer.Stop();
+  wxCommandEvent q(wxEVT_COMMAND_MENU_SELECTED,ID_QUIT);
+  wxPostEvent(this,q);
 }
 
 void SRIMainFrame::OnCameraExperimentBegin(wxCommandEvent& evt){
-  wxLogMessage("Experiment started at "+evt.GetString());
+  CameraUnit* u = find_camera(evt.GetExtraLong());
+  if(!u){
+    return;
+  }
+  wxLogMessage("Experiment started at %s on camera %d",evt.GetString().c_str(),u->index);
+  u->sorter_overflow = false;
 }
 
+// Remove the spool files of the run, unless some of them never made
+// it to the file sorter.
 void SRIMainFrame::OnCameraExperimentEnd(wxCommandEvent& evt){
-  wxLogMessage("Experiment ended.");
-  dispatch_filesorter_command(std::string("CLEANUP:")+evt.GetString().c_str());
+  CameraUnit* u = find_camera(evt.GetExtraLong());
+  if(!u){
+    return;
+  }
+  wxLogMessage("Experiment ended on camera %d.",u->index);
+  if(u->sorter_overflow){
+    wxLogError("Not all images were sorted, keeping spool files \"%s\"",
+               evt.GetString().c_str());
+    return;
+  }
+  dispatch_filesorter_command(FileSorterCommand(FILE_SORTER_CMD_CLEANUP,
+                                                evt.GetString().c_str()));
 }
 
 void SRIMainFrame::OnCameraData(wxCommandEvent& evt){
-  wxString s = evt.GetString();
-  if(s.StartsWith("TEMP:")){
-    SetStatusText("CCD Temperature : "+s.Mid(5),2);
-  }
-  else{
-    wxLogMessage("Unhandled Camera data event: "+evt.GetString());
-  }
+  wxLogMessage("Unhandled Camera data event: "+evt.GetString());
 }
 
 void SRIMainFrame::OnCameraImageReady(wxCommandEvent& evt){
   //wxLogMessage("Image ready");
-  img_frame->UpdateData();
-  wxString loc = evt.GetString();
-  if(loc.Mid(0,1)!=";"){
-    dispatch_filesorter_command(std::string("SORT:")+loc.c_str());
+  CameraUnit* u = find_camera(evt.GetExtraLong());
+  if(!u){
+    return;
+  }
+  // Frames arriving from here on post a new event
+  u->frame_ring.NotifyHandled();
+  u->img_frame->ShowNewestFrame();
+  double now = monotonic_ms();
+  if(now - u->timeline_status_ms > SHOT_TIMELINE_STATUS_PERIOD_MS){
+    u->timeline_status_ms = now;
+    wxString status = u->timeline.FormatStatistics().c_str();
+    if(cameras.size() > 1){
+      status = wxString::Format("cam %d: ",u->index) + status;
+    }
+    SetStatusText(status,1);
+  }
+}
+
+void SRIMainFrame::OnCameraImageSaved(wxCommandEvent& evt){
+  CameraUnit* u = find_camera(evt.GetExtraLong());
+  if(!u){
+    return;
+  }
+  FileSorterCommand cmd(FILE_SORTER_CMD_SORT,evt.GetString().c_str(),evt.GetInt(),
+                        u->index);
+  if(!dispatch_filesorter_command(cmd)){
+    u->sorter_overflow = true;
+  }
+}
+
+// Dump the time stamps of the recent shots for offline analysis. With
+// several cameras, each gets its own file, tagged with _cam<k>.
+void SRIMainFrame::OnSaveShotTimeline(wxCommandEvent&){
+  wxFileDialog dlg(this,_("Save shot timeline"),"","shot_timeline.csv",
+                   "CSV files (*.csv)|*.csv",wxFD_SAVE|wxFD_OVERWRITE_PROMPT);
+  if(dlg.ShowModal() != wxID_OK){
+    return;
+  }
+  for(size_t k=0; k<cameras.size(); ++k){
+    wxFileName f(dlg.GetPath());
+    if(cameras.size() > 1){
+      f.SetName(f.GetName() + wxString::Format("_cam%d",(int)k));
+    }
+    std::string path = f.GetFullPath().c_str();
+    if(cameras[k]->timeline.WriteCSV(path)){
+      wxLogMessage("Shot timeline -> \"%s\"",path.c_str());
+    }
+    else{
+      wxLogError("Failed writing shot timeline to \"%s\"",path.c_str());
+    }
   }
 }
 
@@ -463,81 +671,249 @@ void SRIMainFrame::OnCameraImageReady(wxCommandEvent& evt){
 void SRIMainFrame::OnChangeInterruptField(wxCommandEvent&){
   //wxLogMessage("OnChangeInterruptField %d",evt.GetId());
   read_back_data_from_controls();
-  if(camera_active){
-    dispatch_camera_command("INT:CTL");
+  for(size_t k=0; k<cameras.size(); ++k){
+    apply_controls(cameras[k],false);
   }
+  dispatch_camera_command(CAMERA_CMD_CONTROL);
 }
 
 
-void SRIMainFrame::OnTemperatureTimer(wxTimerEvent&){
-  if(camera_active){
-    dispatch_camera_command("TEMP?");
+// An image window showed a frame for the first time. Stamp its shot,
+// which the event carries as extra long.
+void SRIMainFrame::OnImageFrameShown(wxCommandEvent& evt){
+  for(size_t k=0; k<cameras.size(); ++k){
+    if(cameras[k]->img_frame == evt.GetEventObject() && evt.GetExtraLong() >= 0){
+      cameras[k]->timeline.Stamp(evt.GetExtraLong(),SHOT_DISPLAYED);
+    }
   }
 }
 
-void SRIMainFrame::dispatch_camera_command(const std::string& cmd){
-  wxMutexLocker lock(camera_command_queue_mutex);
-  camera_command_queue.push(cmd);
+// With the readout locked to the ROI, copy the ROI selected in the
+// image window into the readout area controls and hand it to the
+// camera of that window. The other cameras keep their readout area.
+void SRIMainFrame::OnImageReadoutROI(wxCommandEvent& evt){
+  if(!reinterpret_cast<wxCheckBox*>(control_map["lock_readout_to_roi"])->GetValue()){
+    return;
+  }
+  CameraUnit* u = NULL;
+  for(size_t k=0; k<cameras.size(); ++k){
+    if(cameras[k]->img_frame == evt.GetEventObject()){
+      u = cameras[k];
+    }
+  }
+  if(!u){
+    return;
+  }
+  const wxRect& r = u->img_frame->GetReadoutROI();
+  reinterpret_cast<wxTextCtrl*>(control_map["readout_x"])->SetValue(wxString::Format("%d",r.x));
+  reinterpret_cast<wxTextCtrl*>(control_map["readout_y"])->SetValue(wxString::Format("%d",r.y));
+  reinterpret_cast<wxTextCtrl*>(control_map["readout_width"])->SetValue(wxString::Format("%d",r.width));
+  reinterpret_cast<wxTextCtrl*>(control_map["readout_height"])->SetValue(wxString::Format("%d",r.height));
+  wxLogMessage("Readout of camera %d locked to ROI (%d %d %d %d)",
+               u->index,r.x,r.y,r.width,r.height);
+  readout_camera = u->index;
+  read_back_data_from_controls();
+  apply_controls(u,true);
+  dispatch_camera_command(u,CAMERA_CMD_CONTROL);
+}
+
+// Show the latest telemetry of every camera. The telemetry threads
+// sample on their own, so this only reads their rings.
+void SRIMainFrame::OnTelemetryTimer(wxTimerEvent&){
+  wxString t;
+  for(size_t k=0; k<cameras.size(); ++k){
+    TelemetrySample s;
+    if(!cameras[k]->telemetry.GetLatest(s)){
+      continue;
+    }
+    if(!t.IsEmpty()){
+      t += "; ";
+    }
+    t += format_telemetry(s).c_str();
+  }
+  if(!t.IsEmpty()){
+    SetStatusText("CCD : "+t,2);
+  }
+  if(tab_ctrl->GetCurrentPage() == telemetry_plot){
+    telemetry_plot->Refresh();
+  }
+}
+
+CameraUnit* SRIMainFrame::find_camera(long index){
+  if(index < 0 || index >= (long)cameras.size()){
+    return NULL;
+  }
+  return cameras[index];
+}
+
+bool SRIMainFrame::any_camera_active() const {
+  for(size_t k=0; k<cameras.size(); ++k){
+    if(cameras[k]->active){
+      return true;
+    }
+  }
+  return false;
+}
+
+// Send TYPE to every running camera
+void SRIMainFrame::dispatch_camera_command(CameraCommandType type){
+  for(size_t k=0; k<cameras.size(); ++k){
+    dispatch_camera_command(cameras[k],type);
+  }
+}
+
+void SRIMainFrame::dispatch_camera_command(CameraUnit* unit, CameraCommandType type){
+  if(!unit->active){
+    return;
+  }
+  if(!unit->commands.Post(CameraCommand(type))){
+    wxLogError("Camera %d command queue full, dropped command %d",
+               unit->index,(int)type);
+  }
+}
+
+void SRIMainFrame::interrupt_camera_waits(){
+  for(size_t k=0; k<cameras.size(); ++k){
+    if(cameras[k]->active){
+      cameras[k]->worker->InterruptWait();
+    }
+  }
 }
 
-void SRIMainFrame::dispatch_filesorter_command(const std::string& cmd){
-  wxMutexLocker lock(sorter_command_queue_mutex);
-  sorter_command_queue.push(cmd);
+bool SRIMainFrame::dispatch_filesorter_command(const FileSorterCommand& cmd){
+  if(!sorter_commands.Post(cmd)){
+    wxLogError("File sorter queue full, dropped \"%s\"",cmd.path.c_str());
+    return false;
+  }
+  return true;
 }
 
 void SRIMainFrame::read_back_data_from_controls(){
   double t = 0;
   unsigned long i=0;
+  long l=0;
   wxString s;
   bool b = false;
 
   // Update Experimental control data structure
   { // read back data from controls
-    wxMutexLocker lock(experiment_control_mutex);
-
     s = reinterpret_cast<wxTextCtrl*>(control_map["exposure_time"])->GetValue();
     if(s.ToDouble(&t)){
       experiment_control.exposure_time = (float)(t * 1e-3);
     }
     s = reinterpret_cast<wxTextCtrl*>(control_map["image_spool_path"])->GetValue();
     experiment_control.image_spool_path = s;
+    s = reinterpret_cast<wxTextCtrl*>(control_map["trigger_period"])->GetValue();
+    if(s.ToDouble(&t) && t >= 0){
+      experiment_control.trigger_period = (float)t;
+    }
     b = reinterpret_cast<wxCheckBox*>(control_map["save_images"])->GetValue();
     experiment_control.save_images = b;
     b = reinterpret_cast<wxCheckBox*>(control_map["kinetics_mode"])->GetValue();
     experiment_control.kinetics_mode = b;
     b = reinterpret_cast<wxCheckBox*>(control_map["internal_trigger"])->GetValue();
     experiment_control.internal_trigger = b;
+    b = reinterpret_cast<wxCheckBox*>(control_map["blocking_wait"])->GetValue();
+    experiment_control.blocking_wait = b;
+    b = reinterpret_cast<wxCheckBox*>(control_map["pipelined"])->GetValue();
+    experiment_control.pipelined = b;
+    b = reinterpret_cast<wxCheckBox*>(control_map["streaming"])->GetValue();
+    experiment_control.streaming = b;
     s = reinterpret_cast<wxTextCtrl*>(control_map["number_kinetics"])->GetValue();
     if(s.ToULong(&i)){
       experiment_control.number_kinetics = (unsigned int)i;
     }
+    s = reinterpret_cast<wxTextCtrl*>(control_map["readout_x"])->GetValue();
+    if(s.ToLong(&l)){
+      experiment_control.readout_x = (int)l;
+    }
+    s = reinterpret_cast<wxTextCtrl*>(control_map["readout_y"])->GetValue();
+    if(s.ToLong(&l)){
+      experiment_control.readout_y = (int)l;
+    }
+    s = reinterpret_cast<wxTextCtrl*>(control_map["readout_width"])->GetValue();
+    if(s.ToLong(&l)){
+      experiment_control.readout_width = (int)l;
+    }
+    s = reinterpret_cast<wxTextCtrl*>(control_map["readout_height"])->GetValue();
+    if(s.ToLong(&l)){
+      experiment_control.readout_height = (int)l;
+    }
+    s = reinterpret_cast<wxTextCtrl*>(control_map["hbin"])->GetValue();
+    if(s.ToULong(&i) && i > 0){
+      experiment_control.hbin = (unsigned int)i;
+    }
+    s = reinterpret_cast<wxTextCtrl*>(control_map["vbin"])->GetValue();
+    if(s.ToULong(&i) && i > 0){
+      experiment_control.vbin = (unsigned int)i;
+    }
+    b = reinterpret_cast<wxCheckBox*>(control_map["lock_readout_to_roi"])->GetValue();
+    experiment_control.lock_readout_to_roi = b;
     b = reinterpret_cast<wxCheckBox*>(control_map["process_kinetics"])->GetValue();
     experiment_control.process_kinetics = b;
+  }
+
+  // Update the image frames
+  b = reinterpret_cast<wxCheckBox*>(control_map["scale_manual"])->GetValue();
+  PaletteScaling scaling = PALETTE_SCALING_LINEAR;
+  double gamma = 1.0;
+  s = reinterpret_cast<wxTextCtrl*>(control_map["palette_scaling"])->GetValue();
+  PaletteTable::ParseScaling(s.Strip(wxString::both).Lower().c_str(),scaling);
+  s = reinterpret_cast<wxTextCtrl*>(control_map["palette_gamma"])->GetValue();
+  if(!s.ToDouble(&gamma) || gamma <= 0){
+    gamma = 1.0;
+  }
+  ResampleMode resampling = RESAMPLE_NEAREST;
+  s = reinterpret_cast<wxTextCtrl*>(control_map["display_resampling"])->GetValue();
+  ImageResampler::ParseMode(s.Strip(wxString::both).Lower().c_str(),resampling);
+  for(size_t k=0; k<cameras.size(); ++k){
+    ImageFrame* img_frame = cameras[k]->img_frame;
     if(experiment_control.process_kinetics){
       img_frame->SetKinetics(true,experiment_control.number_kinetics);
     }
     else{
       img_frame->SetKinetics(false,1);
     }
+    s = reinterpret_cast<wxTextCtrl*>(control_map["scale_min"])->GetValue();
+    if(s.ToDouble(&t)){
+      img_frame->SetScaleMin(t);
+    }
+    s = reinterpret_cast<wxTextCtrl*>(control_map["scale_max"])->GetValue();
+    if(s.ToDouble(&t)){
+      img_frame->SetScaleMax(t);
+    }
+    img_frame->SetPaletteScaling(scaling,(float)gamma);
+    img_frame->SetResampling(resampling);
+    if(b != img_frame->GetScaleManual()){
+      img_frame->SetScaleManual(b);
+      if(!b){
+        // Autoscale to next image if manual scaling deselected
+        img_frame->SetScaleNextImage();
+      }
+    }
   }
+}
 
-  // Update the rest
-  b = reinterpret_cast<wxCheckBox*>(control_map["scale_manual"])->GetValue();
-  s = reinterpret_cast<wxTextCtrl*>(control_map["scale_min"])->GetValue();
-  if(s.ToDouble(&t)){
-    img_frame->SetScaleMin(t);
-  }
-  s = reinterpret_cast<wxTextCtrl*>(control_map["scale_max"])->GetValue();
-  if(s.ToDouble(&t)){
-    img_frame->SetScaleMax(t);
+// Hand the settings read back from the controls to the camera of
+// UNIT. Camera k > 0 spools into the subdirectory cam<k> of the spool
+// directory. The readout area is only copied if READOUT is set, so
+// that every camera can keep its own.
+void SRIMainFrame::apply_controls(CameraUnit* unit, bool readout){
+  wxMutexLocker lock(unit->control_mutex);
+  CameraExperimentControl c = experiment_control;
+  if(unit->index > 0){
+    c.image_spool_path += PATH_SEPARATOR;
+    c.image_spool_path += wxString::Format("cam%d",unit->index).c_str();
   }
-  if(b != img_frame->GetScaleManual()){
-    img_frame->SetScaleManual(b);
-    if(!b){
-      // Autoscale to next image if manual scaling deselected
-      img_frame->SetScaleNextImage();
-    }
+  if(!readout){
+    c.readout_x = unit->control.readout_x;
+    c.readout_y = unit->control.readout_y;
+    c.readout_width = unit->control.readout_width;
+    c.readout_height = unit->control.readout_height;
+    c.hbin = unit->control.hbin;
+    c.vbin = unit->control.vbin;
   }
+  unit->control = c;
 }
 
 void SRIMainFrame::OnFileSorterWorkerDone(wxCommandEvent&){
@@ -0,0 +1,44 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 12:20:14 sb"
+
+/*
+  file       monotonic_clock.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+  High resolution monotonic time stamps for latency measurements.
+  wxStopWatch and wxGetLocalTimeMillis only tick with the system timer
+  (~15 ms on Windows), which is too coarse.
+
+ */
+
+
+#ifndef MONOTONIC_CLOCK_HH
+#define MONOTONIC_CLOCK_HH
+
+#ifdef _WIN32
+#include <wx/msw/wrapwin.h>
+#else
+#include <time.h>
+#endif
+
+// Milliseconds since an arbitrary but fixed origin.
+inline double monotonic_ms(){
+#ifdef _WIN32
+  static LARGE_INTEGER freq = {0};
+  LARGE_INTEGER t;
+  if(freq.QuadPart == 0){
+    QueryPerformanceFrequency(&freq);
+  }
+  QueryPerformanceCounter(&t);
+  return 1e3 * (double)t.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  return 1e3 * t.tv_sec + 1e-6 * t.tv_nsec;
+#endif
+}
+
+
+#endif // MONOTONIC_CLOCK_HH
+
+// monotonic_clock.hh ends here
@@ -0,0 +1,229 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 22:18:30 sb"
+
+/*
+  file       od_kernels.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "od_kernels.hh"
+#include "atomic_ops.hh"
+
+// The AVX2 kernel needs the gather intrinsics, which are available
+// from VS2012 and gcc 4.9 on. gcc compiles it for its own target, so
+// that the rest of the program does not depend on the instruction
+// set.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#if (defined(_MSC_VER) && _MSC_VER >= 1700) || \
+    (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define OD_HAVE_AVX2
+#endif
+#endif
+
+#ifdef OD_HAVE_AVX2
+#ifdef _MSC_VER
+#include <intrin.h>
+#define OD_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define OD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#include <immintrin.h>
+#endif
+
+typedef void (*od_absorption_t)(const pixel_t*, const pixel_t*, const pixel_t*, float*, size_t);
+typedef void (*od_log_counts_t)(const pixel_t*, float*, size_t);
+
+struct OdKernelTable {
+  const char* name;
+  od_absorption_t absorption;
+  od_log_counts_t log_counts;
+};
+
+static float od_table[OD_LOG_TABLE_SIZE];
+static atomic_long_t od_table_ready = 0;
+
+// Threads racing to fill the table all write the same values.
+const float* od_log_table(){
+  if(!atomic_get(&od_table_ready)){
+    for(int x=0; x<OD_LOG_TABLE_SIZE; ++x){
+      od_table[x] = od_log(x);
+    }
+    atomic_set(&od_table_ready,1);
+  }
+  return od_table;
+}
+
+// Table index of count difference X
+static inline int od_index(int x){
+  return x > 0 ? x : 0;
+}
+
+
+// Scalar kernels, also used for the tails of the vector kernels
+
+static void od_absorption_scalar(const pixel_t* light, const pixel_t* shadow,
+                                 const pixel_t* dark, float* od, size_t n)
+{
+  const float* t = od_table;
+  if(dark){
+    for(size_t i=0; i<n; ++i){
+      int d = dark[i];
+      od[i] = t[od_index(light[i]-d)] - t[od_index(shadow[i]-d)];
+    }
+  }
+  else{
+    for(size_t i=0; i<n; ++i){
+      od[i] = t[light[i]] - t[shadow[i]];
+    }
+  }
+}
+
+static void od_log_counts_scalar(const pixel_t* shadow, float* od, size_t n){
+  const float* t = od_table;
+  for(size_t i=0; i<n; ++i){
+    od[i] = t[shadow[i]];
+  }
+}
+
+
+#ifdef OD_HAVE_AVX2
+
+static inline OD_TARGET_AVX2 __m256i od_load_avx2(const pixel_t* p){
+  return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p));
+}
+
+static OD_TARGET_AVX2 void od_absorption_avx2(const pixel_t* light, const pixel_t* shadow,
+                                              const pixel_t* dark, float* od, size_t n)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for(; i+8 <= n; i+=8){
+    __m256i l = od_load_avx2(light+i);
+    __m256i s = od_load_avx2(shadow+i);
+    if(dark){
+      __m256i d = od_load_avx2(dark+i);
+      l = _mm256_max_epi32(_mm256_sub_epi32(l,d),zero);
+      s = _mm256_max_epi32(_mm256_sub_epi32(s,d),zero);
+    }
+    _mm256_storeu_ps(od+i,_mm256_sub_ps(_mm256_i32gather_ps(od_table,l,4),
+                                        _mm256_i32gather_ps(od_table,s,4)));
+  }
+  _mm256_zeroupper();
+  od_absorption_scalar(light+i,shadow+i,dark ? dark+i : NULL,od+i,n-i);
+}
+
+static OD_TARGET_AVX2 void od_log_counts_avx2(const pixel_t* shadow, float* od, size_t n){
+  size_t i = 0;
+  for(; i+8 <= n; i+=8){
+    _mm256_storeu_ps(od+i,_mm256_i32gather_ps(od_table,od_load_avx2(shadow+i),4));
+  }
+  _mm256_zeroupper();
+  od_log_counts_scalar(shadow+i,od+i,n-i);
+}
+
+#endif // OD_HAVE_AVX2
+
+
+static const OdKernelTable od_kernels[OD_KERNELS] = {
+  {"scalar", od_absorption_scalar, od_log_counts_scalar},
+#ifdef OD_HAVE_AVX2
+  {"avx2", od_absorption_avx2, od_log_counts_avx2},
+#else
+  {"avx2", NULL, NULL},
+#endif
+};
+
+// Selected kernel, -1 until the first call
+static atomic_long_t od_current_kernel = -1;
+
+#ifdef OD_HAVE_AVX2
+static void od_cpuid(int leaf, unsigned int r[4]){
+#ifdef _MSC_VER
+  int regs[4];
+  __cpuidex(regs,leaf,0);
+  for(int k=0; k<4; ++k){
+    r[k] = (unsigned int)regs[k];
+  }
+#else
+  r[0] = r[1] = r[2] = r[3] = 0;
+  if((unsigned int)leaf <= __get_cpuid_max(0,NULL)){
+    __cpuid_count(leaf,0,r[0],r[1],r[2],r[3]);
+  }
+#endif
+}
+
+// Whether the operating system saves the AVX registers on context
+// switches.
+static bool od_os_saves_avx(){
+  unsigned int r[4];
+  od_cpuid(1,r);
+  if(!(r[2] & (1u << 27))){ // OSXSAVE
+    return false;
+  }
+#ifdef _MSC_VER
+  return (_xgetbv(0) & 6) == 6;
+#else
+  unsigned int lo = 0, hi = 0;
+  __asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(0));
+  return (lo & 6) == 6;
+#endif
+}
+#endif // OD_HAVE_AVX2
+
+bool od_kernel_supported(OdKernel k){
+  if(k < 0 || k >= OD_KERNELS || !od_kernels[k].absorption){
+    return false;
+  }
+#ifdef OD_HAVE_AVX2
+  if(k == OD_KERNEL_AVX2){
+    unsigned int r[4];
+    od_cpuid(7,r);
+    return (r[1] & (1u << 5)) != 0 && od_os_saves_avx();
+  }
+#endif
+  return true;
+}
+
+bool od_set_kernel(OdKernel k){
+  if(!od_kernel_supported(k)){
+    return false;
+  }
+  od_log_table();
+  atomic_set(&od_current_kernel,k);
+  return true;
+}
+
+// The fastest supported kernel is the one listed last.
+OdKernel od_get_kernel(){
+  long k = atomic_get(&od_current_kernel);
+  if(k < 0){
+    k = OD_KERNELS-1;
+    while(k > 0 && !od_kernel_supported((OdKernel)k)){
+      --k;
+    }
+    od_log_table();
+    atomic_set(&od_current_kernel,k);
+  }
+  return (OdKernel)k;
+}
+
+const char* od_kernel_name(OdKernel k){
+  if(k < 0 || k >= OD_KERNELS){
+    return "unknown";
+  }
+  return od_kernels[k].name;
+}
+
+void od_absorption(const pixel_t* light, const pixel_t* shadow, const pixel_t* dark,
+                   float* od, size_t n)
+{
+  od_kernels[od_get_kernel()].absorption(light,shadow,dark,od,n);
+}
+
+void od_log_counts(const pixel_t* shadow, float* od, size_t n){
+  od_kernels[od_get_kernel()].log_counts(shadow,od,n);
+}
+
+// od_kernels.cc ends here
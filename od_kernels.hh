@@ -0,0 +1,69 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 22:18:30 sb"
+
+/*
+  file       od_kernels.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+  Optical density kernels for absorption imaging. Every kernel takes
+  the 16 bit camera counts of the light, shadow and dark images and
+  computes
+
+    od = L(light - dark) - L(shadow - dark),  L(x) = x > 0 ? ln(x) : -1
+
+  The counts are integers below 2^16, so L is looked up in a table
+  indexed by the count difference clamped to >= 0, which holds -1 at
+  zero. This matches logf exactly. There is a scalar kernel and an
+  AVX2 kernel using gathered loads. The fastest kernel the CPU
+  supports is picked on first use.
+
+ */
+
+
+#ifndef OD_KERNELS_HH
+#define OD_KERNELS_HH
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+#include "frame_ring.hh"
+
+// Number of entries in the log table, one per 16 bit count
+#define OD_LOG_TABLE_SIZE 65536
+
+enum OdKernel {
+  OD_KERNEL_SCALAR = 0,
+  OD_KERNEL_AVX2,
+  OD_KERNELS
+};
+
+// Logarithm of the pixel difference X clamped to -1 where X <= 0,
+// as used in the OD formula.
+inline float od_log(int x){
+  return x > 0 ? std::max(logf((float)x),-1.0f) : -1.0f;
+}
+
+// Table of L(x) for x in [0, OD_LOG_TABLE_SIZE), filled on first
+// use.
+const float* od_log_table();
+
+// OD of N pixels into OD. Without a dark image, DARK is NULL.
+void od_absorption(const pixel_t* light, const pixel_t* shadow, const pixel_t* dark,
+                   float* od, size_t n);
+
+// L(shadow) of N pixels into OD, for kinetics series with only a
+// shadow image.
+void od_log_counts(const pixel_t* shadow, float* od, size_t n);
+
+// Kernel selection. od_set_kernel() fails if the CPU or the compiler
+// do not support K.
+bool od_kernel_supported(OdKernel k);
+bool od_set_kernel(OdKernel k);
+OdKernel od_get_kernel();
+const char* od_kernel_name(OdKernel k);
+
+
+#endif // OD_KERNELS_HH
+
+// od_kernels.hh ends here
@@ -0,0 +1,105 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 23:57:30 sb"
+
+/*
+  file       palette_table.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "palette_table.hh"
+#include "image_window.hh"
+
+#include <cmath>
+#include <algorithm>
+
+static const char* scaling_names[PALETTE_SCALINGS] = {"linear","log","gamma"};
+
+PaletteTable::PaletteTable()
+  : palette(6,0),
+    table(3*PALETTE_TABLE_SIZE,0),
+    scaling(PALETTE_SCALING_LINEAR),
+    gamma(1.0f),
+    t0(0),
+    scale(0)
+{
+  palette[3] = palette[4] = palette[5] = 0xff; // black to white
+  rebuild();
+}
+
+// Fill the table from the palette. Entry k belongs to the position
+// u = k/(PALETTE_TABLE_SIZE-1) of the scale range, which the scaling
+// maps onto the palette.
+void PaletteTable::rebuild(){
+  const float decades = PALETTE_LOG_DECADES;
+  const float a = powf(10.0f,decades) - 1.0f;
+  size_t n = GetPaletteSize();
+  for(size_t k=0; k<PALETTE_TABLE_SIZE; ++k){
+    float u = (float)k / (PALETTE_TABLE_SIZE-1);
+    float p = u;
+    if(scaling == PALETTE_SCALING_LOG){
+      p = log10f(1.0f + a*u) / decades;
+    }
+    else if(scaling == PALETTE_SCALING_GAMMA){
+      p = powf(u,gamma);
+    }
+    interpolate_color(std::min(std::max(p,0.0f),1.0f),&table[3*k],&palette[0],n);
+  }
+}
+
+void PaletteTable::SetPalette(const unsigned char* pal, size_t n){
+  if(!pal || n < 2){
+    return;
+  }
+  palette.assign(pal,pal+3*n);
+  rebuild();
+}
+
+void PaletteTable::SetScaling(PaletteScaling scaling_, float gamma_){
+  if(!(gamma_ > 0)){
+    gamma_ = 1.0f;
+  }
+  if(scaling_ == scaling && (scaling != PALETTE_SCALING_GAMMA || gamma_ == gamma)){
+    return;
+  }
+  scaling = scaling_;
+  gamma = gamma_;
+  rebuild();
+}
+
+// An empty range maps everything to the minimum color.
+void PaletteTable::SetRange(float t0_, float t1_){
+  t0 = t0_;
+  scale = t1_ > t0_ ? (PALETTE_TABLE_SIZE-1) / (t1_ - t0_) : 0;
+}
+
+const unsigned char* PaletteTable::GetColor(float u) const {
+  float x = u * (PALETTE_TABLE_SIZE-1);
+  size_t k = 0;
+  if(x >= PALETTE_TABLE_SIZE-1){
+    k = PALETTE_TABLE_SIZE-1;
+  }
+  else if(x > 0){
+    k = (size_t)(x + 0.5f);
+  }
+  return &table[3*k];
+}
+
+const char* PaletteTable::GetScalingName(PaletteScaling s){
+  if(s < 0 || s >= PALETTE_SCALINGS){
+    return "unknown";
+  }
+  return scaling_names[s];
+}
+
+bool PaletteTable::ParseScaling(const std::string& name, PaletteScaling& s){
+  for(int k=0; k<PALETTE_SCALINGS; ++k){
+    if(name == scaling_names[k]){
+      s = (PaletteScaling)k;
+      return true;
+    }
+  }
+  return false;
+}
+
+// palette_table.cc ends here
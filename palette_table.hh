@@ -0,0 +1,88 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 23:48:12 sb"
+
+/*
+  file       palette_table.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef PALETTE_TABLE_HH
+#define PALETTE_TABLE_HH
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Number of colors the palette is expanded into
+#define PALETTE_TABLE_SIZE 4096
+
+// Decades between scale minimum and maximum for log scaling
+#define PALETTE_LOG_DECADES 3.0f
+
+// How values between scale minimum and maximum map onto the palette
+enum PaletteScaling {
+  PALETTE_SCALING_LINEAR = 0,
+  PALETTE_SCALING_LOG,
+  PALETTE_SCALING_GAMMA,
+  PALETTE_SCALINGS
+};
+
+/*
+  Palette expanded into PALETTE_TABLE_SIZE RGB colors, evenly spaced
+  between scale minimum and maximum, with the scaling applied when
+  building the table. Coloring a pixel is then a scale, a clamp and a
+  table load. The table is only rebuilt when the palette or the
+  scaling changes. Changing the scale range costs nothing.
+ */
+class PaletteTable {
+  private:
+    std::vector<unsigned char> palette; // palette colors, 3 bytes each
+    std::vector<unsigned char> table; // expanded palette, 3 bytes each
+    PaletteScaling scaling;
+    float gamma; // exponent for PALETTE_SCALING_GAMMA
+    float t0; // scale minimum
+    float scale; // table entries per unit between scale minimum and maximum
+
+    void rebuild();
+
+  public:
+    PaletteTable();
+
+    // Use the N colors of PAL, 3 bytes each.
+    void SetPalette(const unsigned char* pal, size_t n);
+    void SetScaling(PaletteScaling scaling_, float gamma_=1.0f);
+    void SetRange(float t0_, float t1_);
+
+    const unsigned char* GetPalette() const {return palette.empty() ? NULL : &palette[0];}
+    size_t GetPaletteSize() const {return palette.size()/3;}
+    PaletteScaling GetScaling() const {return scaling;}
+    float GetGamma() const {return gamma;}
+
+    // Color of value T. Values outside of the scale range get the
+    // palette end colors, NaN the minimum color.
+    const unsigned char* Lookup(float t) const {
+      float x = (t - t0) * scale;
+      size_t k = 0;
+      if(x >= PALETTE_TABLE_SIZE-1){
+        k = PALETTE_TABLE_SIZE-1;
+      }
+      else if(x > 0){
+        k = (size_t)(x + 0.5f);
+      }
+      return &table[3*k];
+    }
+
+    // Color at position U in [0,1] of the scale range, for legends
+    const unsigned char* GetColor(float u) const;
+
+    static const char* GetScalingName(PaletteScaling s);
+    // Look up the scaling called NAME. Returns false if there is none.
+    static bool ParseScaling(const std::string& name, PaletteScaling& s);
+};
+
+
+#endif // PALETTE_TABLE_HH
+
+// palette_table.hh ends here
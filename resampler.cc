@@ -0,0 +1,170 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-18 03:07:52 sb"
+
+/*
+  file       resampler.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "resampler.hh"
+
+#include <algorithm>
+
+static const char* mode_names[RESAMPLE_MODES] = {"nearest","bilinear"};
+
+ImageResampler::ImageResampler()
+  : mode(RESAMPLE_NEAREST),
+    src_width(0),
+    roi(0,0,0,0),
+    size(0,0),
+    table_mode(RESAMPLE_NEAREST)
+{
+}
+
+/*
+  Display column X shows column XS of the rotated ROI, which is source
+  row roi.y + roi.height-1 - XS. Display row Y shows row YS of the
+  rotated ROI, which is source column roi.x + YS. Nearest uses the
+  16.16 fixed point steps of wxImage::Scale(), bilinear maps pixel
+  centers onto pixel centers.
+ */
+void ImageResampler::build_tables(){
+  size_t w = size.GetWidth(), h = size.GetHeight();
+  size_t rw = roi.width, rh = roi.height; // rotated ROI is RH wide, RW high
+  size_t line = 3*src_width;
+  row0.resize(w); row1.resize(w); row_weight.resize(w);
+  col0.resize(h); col1.resize(h); col_weight.resize(h);
+
+  if(mode == RESAMPLE_NEAREST){
+    size_t dx = (rh << 16) / w, dy = (rw << 16) / h;
+    for(size_t x=0; x<w; ++x){
+      row0[x] = row1[x] = (roi.y + rh-1 - ((x*dx) >> 16)) * line;
+      row_weight[x] = 0;
+    }
+    for(size_t y=0; y<h; ++y){
+      col0[y] = col1[y] = 3*(roi.x + ((y*dy) >> 16));
+      col_weight[y] = 0;
+    }
+  }
+  else{
+    for(size_t x=0; x<w; ++x){
+      double u = (x + 0.5) * rh / w - 0.5;
+      u = std::min(std::max(u,0.0),(double)(rh-1));
+      size_t i0 = (size_t)u, i1 = std::min(i0+1,rh-1);
+      row0[x] = (roi.y + rh-1 - i0) * line;
+      row1[x] = (roi.y + rh-1 - i1) * line;
+      row_weight[x] = (unsigned int)((u - i0) * 256 + 0.5);
+    }
+    for(size_t y=0; y<h; ++y){
+      double v = (y + 0.5) * rw / h - 0.5;
+      v = std::min(std::max(v,0.0),(double)(rw-1));
+      size_t i0 = (size_t)v, i1 = std::min(i0+1,rw-1);
+      col0[y] = 3*(roi.x + i0);
+      col1[y] = 3*(roi.x + i1);
+      col_weight[y] = (unsigned int)((v - i0) * 256 + 0.5);
+    }
+  }
+  table_mode = mode;
+}
+
+// Display pixel (x, y) at DST + y STRIDE + 3 x is source pixel
+// SRC + row0[x] + col0[y]. Runs down tiles of display rows, so that
+// consecutive reads hit neighboring pixels of the same source row.
+void ImageResampler::nearest(const unsigned char* src, unsigned char* dst, size_t stride) const {
+  size_t w = row0.size(), h = col0.size();
+  for(size_t ty=0; ty<h; ty+=RESAMPLER_TILE_ROWS){
+    size_t ty1 = std::min(ty+RESAMPLER_TILE_ROWS,h);
+    for(size_t x=0; x<w; ++x){
+      const unsigned char* s = src + row0[x];
+      unsigned char* d = dst + 3*x;
+      for(size_t y=ty; y<ty1; ++y){
+        const unsigned char* p = s + col0[y];
+        unsigned char* q = d + y*stride;
+        q[0] = p[0]; q[1] = p[1]; q[2] = p[2];
+      }
+    }
+  }
+}
+
+void ImageResampler::bilinear(const unsigned char* src, unsigned char* dst, size_t stride) const {
+  size_t w = row0.size(), h = col0.size();
+  for(size_t ty=0; ty<h; ty+=RESAMPLER_TILE_ROWS){
+    size_t ty1 = std::min(ty+RESAMPLER_TILE_ROWS,h);
+    for(size_t x=0; x<w; ++x){
+      const unsigned char* s0 = src + row0[x];
+      const unsigned char* s1 = src + row1[x];
+      unsigned int a = row_weight[x], a0 = 256 - a;
+      unsigned char* d = dst + 3*x;
+      for(size_t y=ty; y<ty1; ++y){
+        const unsigned char* p00 = s0 + col0[y];
+        const unsigned char* p01 = s0 + col1[y];
+        const unsigned char* p10 = s1 + col0[y];
+        const unsigned char* p11 = s1 + col1[y];
+        unsigned int b = col_weight[y], b0 = 256 - b;
+        unsigned char* q = d + y*stride;
+        for(size_t c=0; c<3; ++c){
+          unsigned int t0 = b0*p00[c] + b*p01[c];
+          unsigned int t1 = b0*p10[c] + b*p11[c];
+          q[c] = (unsigned char)((a0*t0 + a*t1 + 32768) >> 16);
+        }
+      }
+    }
+  }
+}
+
+void ImageResampler::Run(const unsigned char* src, size_t src_width_, const wxRect& roi_,
+                         unsigned char* dst, size_t dst_width, size_t dst_height,
+                         const wxRect& target)
+{
+  size_t stride = 3*dst_width;
+  size_t tx = target.x, ty = target.y, tw = target.width, th = target.height;
+  if(roi_.IsEmpty() || target.IsEmpty()){
+    tw = th = 0;
+  }
+
+  // Black outside of TARGET
+  std::fill(dst,dst+ty*stride,0);
+  for(size_t y=ty; y<ty+th; ++y){
+    unsigned char* d = dst + y*stride;
+    std::fill(d,d+3*tx,0);
+    std::fill(d+3*(tx+tw),d+stride,0);
+  }
+  std::fill(dst+(ty+th)*stride,dst+dst_height*stride,0);
+  if(tw == 0 || th == 0){
+    return;
+  }
+
+  if(src_width_ != src_width || roi_ != roi || target.GetSize() != size || mode != table_mode){
+    src_width = src_width_;
+    roi = roi_;
+    size = target.GetSize();
+    build_tables();
+  }
+  unsigned char* d = dst + ty*stride + 3*tx;
+  if(table_mode == RESAMPLE_BILINEAR){
+    bilinear(src,d,stride);
+  }
+  else{
+    nearest(src,d,stride);
+  }
+}
+
+const char* ImageResampler::GetModeName(ResampleMode m){
+  if(m < 0 || m >= RESAMPLE_MODES){
+    return "unknown";
+  }
+  return mode_names[m];
+}
+
+bool ImageResampler::ParseMode(const std::string& name, ResampleMode& m){
+  for(int k=0; k<RESAMPLE_MODES; ++k){
+    if(name == mode_names[k]){
+      m = (ResampleMode)k;
+      return true;
+    }
+  }
+  return false;
+}
+
+// resampler.cc ends here
@@ -0,0 +1,85 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-18 02:41:15 sb"
+
+/*
+  file       resampler.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef RESAMPLER_HH
+#define RESAMPLER_HH
+
+#include <wx/wx.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Output rows resampled together, so that the source pixels of
+// neighboring output rows are still in cache
+#define RESAMPLER_TILE_ROWS 16
+
+// How source pixels are picked for a display pixel
+enum ResampleMode {
+  RESAMPLE_NEAREST = 0,
+  RESAMPLE_BILINEAR,
+  RESAMPLE_MODES
+};
+
+/*
+  Cuts a ROI out of an RGB image, rotates it by 90 degrees clockwise
+  and scales it, writing straight into a display buffer. Each display
+  column comes from one source row (two for bilinear), and each
+  display row from one source column, so two index tables map every
+  display pixel to its source pixels. The tables are only rebuilt
+  when the ROI, the scaled size or the mode change.
+
+  Nearest picks the same pixels as wxImage::Rotate90() followed by
+  wxImage::Rescale(). Bilinear blends the four nearest pixels with
+  8 bit weights.
+ */
+class ImageResampler {
+  private:
+    ResampleMode mode;
+    size_t src_width; // source image width the tables are for
+    wxRect roi; // source region the tables are for
+    wxSize size; // scaled size the tables are for
+    ResampleMode table_mode; // mode the tables are for
+
+    // Per display column: byte offsets of the source rows, bilinear
+    // weight of the second row in 1/256
+    std::vector<size_t> row0, row1;
+    std::vector<unsigned int> row_weight;
+    // Per display row: byte offsets of the source columns, bilinear
+    // weight of the second column in 1/256
+    std::vector<size_t> col0, col1;
+    std::vector<unsigned int> col_weight;
+
+    void build_tables();
+    void nearest(const unsigned char* src, unsigned char* dst, size_t stride) const;
+    void bilinear(const unsigned char* src, unsigned char* dst, size_t stride) const;
+
+  public:
+    ImageResampler();
+
+    void SetMode(ResampleMode mode_){mode = mode_;}
+    ResampleMode GetMode() const {return mode;}
+
+    // Resample region ROI_ of the RGB image SRC, SRC_WIDTH_ pixels
+    // wide, into rectangle TARGET of the RGB buffer DST of DST_WIDTH x
+    // DST_HEIGHT pixels. The rest of DST turns black. TARGET has to
+    // lie within DST.
+    void Run(const unsigned char* src, size_t src_width_, const wxRect& roi_,
+             unsigned char* dst, size_t dst_width, size_t dst_height,
+             const wxRect& target);
+
+    static const char* GetModeName(ResampleMode m);
+    // Look up the mode called NAME. Returns false if there is none.
+    static bool ParseMode(const std::string& name, ResampleMode& m);
+};
+
+
+#endif // RESAMPLER_HH
+
+// resampler.hh ends here
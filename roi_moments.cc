@@ -0,0 +1,136 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-18 00:46:05 sb"
+
+/*
+  file       roi_moments.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "roi_moments.hh"
+
+#include <algorithm>
+
+// SSE2 is part of every x64 CPU. 32 bit builds only use it when
+// compiled for it (/arch:SSE2, -msse2).
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ROI_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+void RoiMoments::AddRow(const RowMoments& r, size_t n_row, double y){
+  if(n_row == 0){
+    return;
+  }
+  n += n_row;
+  if(r.tmin < tmin){ tmin = r.tmin; }
+  if(r.tmax > tmax){ tmax = r.tmax; }
+  s.Add(r.s);
+  sx.Add(r.sx);
+  sy.Add(y*r.s);
+  sxx.Add(r.sxx);
+  syy.Add(y*y*r.s);
+  sxy.Add(y*r.sx);
+}
+
+void RoiMoments::Add(const RoiMoments& m){
+  n += m.n;
+  tmin = std::min(tmin,m.tmin);
+  tmax = std::max(tmax,m.tmax);
+  s.Add(m.s);
+  sx.Add(m.sx);
+  sy.Add(m.sy);
+  sxx.Add(m.sxx);
+  syy.Add(m.syy);
+  sxy.Add(m.sxy);
+}
+
+// Pixels [I, N) of ROW, added to M
+template <typename T>
+static void row_moments_scalar(const T* row, size_t i, size_t n, RowMoments& m){
+  for(; i<n; ++i){
+    float t = (float)row[i];
+    double x = (double)i;
+    if(t < m.tmin){ m.tmin = t; }
+    if(t > m.tmax){ m.tmax = t; }
+    m.s += t;
+    m.sx += t*x;
+    m.sxx += t*x*x;
+  }
+}
+
+#ifdef ROI_HAVE_SSE2
+
+static inline __m128 load4(const float* p){
+  return _mm_loadu_ps(p);
+}
+
+static inline __m128 load4(const pixel_t* p){
+  __m128i v = _mm_loadl_epi64((const __m128i*)p);
+  return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v,_mm_setzero_si128()));
+}
+
+static inline double sum2(__m128d v){
+  return _mm_cvtsd_f64(_mm_add_sd(v,_mm_unpackhi_pd(v,v)));
+}
+
+// Four pixels at a time, converted to double for the sums. Returns
+// the number of pixels done.
+template <typename T>
+static size_t row_moments_sse2(const T* row, size_t n, RowMoments& m){
+  __m128 vmin = _mm_set1_ps(m.tmin), vmax = _mm_set1_ps(m.tmax);
+  __m128d s0 = _mm_setzero_pd(), s1 = s0, sx0 = s0, sx1 = s0, sxx0 = s0, sxx1 = s0;
+  __m128d x0 = _mm_set_pd(1,0), x1 = _mm_set_pd(3,2);
+  const __m128d four = _mm_set1_pd(4);
+  size_t i = 0;
+  for(; i+4 <= n; i+=4){
+    __m128 v = load4(row+i);
+    // NaN compares false, keep the old extremes then
+    vmin = _mm_min_ps(v,vmin);
+    vmax = _mm_max_ps(v,vmax);
+    __m128d lo = _mm_cvtps_pd(v), hi = _mm_cvtps_pd(_mm_movehl_ps(v,v));
+    __m128d tx0 = _mm_mul_pd(lo,x0), tx1 = _mm_mul_pd(hi,x1);
+    s0 = _mm_add_pd(s0,lo);
+    s1 = _mm_add_pd(s1,hi);
+    sx0 = _mm_add_pd(sx0,tx0);
+    sx1 = _mm_add_pd(sx1,tx1);
+    sxx0 = _mm_add_pd(sxx0,_mm_mul_pd(tx0,x0));
+    sxx1 = _mm_add_pd(sxx1,_mm_mul_pd(tx1,x1));
+    x0 = _mm_add_pd(x0,four);
+    x1 = _mm_add_pd(x1,four);
+  }
+  float e[4];
+  _mm_storeu_ps(e,vmin);
+  m.tmin = std::min(std::min(e[0],e[1]),std::min(e[2],e[3]));
+  _mm_storeu_ps(e,vmax);
+  m.tmax = std::max(std::max(e[0],e[1]),std::max(e[2],e[3]));
+  m.s += sum2(_mm_add_pd(s0,s1));
+  m.sx += sum2(_mm_add_pd(sx0,sx1));
+  m.sxx += sum2(_mm_add_pd(sxx0,sxx1));
+  return i;
+}
+
+#endif // ROI_HAVE_SSE2
+
+template <typename T>
+static void row_moments(const T* row, size_t n, RowMoments& m){
+  m.tmin = FLT_MAX;
+  m.tmax = -FLT_MAX;
+  m.s = m.sx = m.sxx = 0;
+  size_t i = 0;
+#ifdef ROI_HAVE_SSE2
+  i = row_moments_sse2(row,n,m);
+#endif
+  row_moments_scalar(row,i,n,m);
+}
+
+void roi_row_moments(const float* row, size_t n, RowMoments& m){
+  row_moments(row,n,m);
+}
+
+void roi_row_moments(const pixel_t* row, size_t n, RowMoments& m){
+  row_moments(row,n,m);
+}
+
+// roi_moments.cc ends here
@@ -0,0 +1,80 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-18 00:31:52 sb"
+
+/*
+  file       roi_moments.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+  Moments of the pixel values t inside a region of interest, for the
+  total, the mean, the center of mass and the second moments. The
+  pixels of one row are summed in double precision, with SSE2 where
+  available. Row sums are added up with compensated summation, so
+  that the result does not degrade on large ROIs.
+
+ */
+
+
+#ifndef ROI_MOMENTS_HH
+#define ROI_MOMENTS_HH
+
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+
+#include "frame_ring.hh"
+
+// Sum with Neumaier's compensation, which also holds when an added
+// value is larger than the sum so far.
+class CompensatedSum {
+  private:
+    double sum;
+    double c; // lost low order bits
+  public:
+    CompensatedSum() : sum(0), c(0) {}
+    void Add(double v){
+      double t = sum + v;
+      if(fabs(sum) >= fabs(v)){
+        c += (sum - t) + v;
+      }
+      else{
+        c += (v - t) + sum;
+      }
+      sum = t;
+    }
+    void Add(const CompensatedSum& s){
+      Add(s.sum);
+      Add(s.c);
+    }
+    double Get() const {return sum + c;}
+};
+
+// Sums over one row of N pixels t at x = 0 ... N-1
+class RowMoments {
+  public:
+    float tmin, tmax;
+    double s, sx, sxx; // sums of t, t x, t x^2
+};
+
+// Sums of the pixels t at ROI coordinates (x, y) of any number of
+// rows
+class RoiMoments {
+  public:
+    size_t n; // number of pixels
+    float tmin, tmax;
+    CompensatedSum s, sx, sy; // sums of t, t x, t y
+    CompensatedSum sxx, syy, sxy; // sums of t x^2, t y^2, t x y
+
+    RoiMoments() : n(0), tmin(FLT_MAX), tmax(-FLT_MAX) {}
+    void AddRow(const RowMoments& r, size_t n_row, double y);
+    void Add(const RoiMoments& m);
+};
+
+// Sums over the N pixels of ROW. NaN pixels do not count for the
+// minimum and maximum.
+void roi_row_moments(const float* row, size_t n, RowMoments& m);
+void roi_row_moments(const pixel_t* row, size_t n, RowMoments& m);
+
+
+#endif // ROI_MOMENTS_HH
+
+// roi_moments.hh ends here
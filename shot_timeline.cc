@@ -0,0 +1,217 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 15:40:03 sb"
+
+/*
+  file       shot_timeline.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "shot_timeline.hh"
+#include "monotonic_clock.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+// Column names in the CSV file, then the names of the two derived
+// statistics.
+static const char* stage_names[SHOT_STAGES+2] = {
+  "arm", "acquired", "download_begin", "download_end",
+  "posted", "displayed", "save_begin", "save_end",
+  "total", "cycle"
+};
+
+// Short names for the status bar. A stage is labeled by the interval
+// that ends with it.
+static const char* stage_labels[SHOT_STAGES+2] = {
+  "arm", "wait", "prep", "dl", "post", "disp", "queue", "save",
+  "total", "cycle"
+};
+
+// The stage each stage follows in the pipeline. Display and saving
+// both start from the downloaded frame.
+static const size_t stage_parent[SHOT_STAGES] = {
+  SHOT_ARM, SHOT_ARM, SHOT_ACQUIRED, SHOT_DOWNLOAD_BEGIN,
+  SHOT_DOWNLOAD_END, SHOT_POSTED, SHOT_DOWNLOAD_END, SHOT_SAVE_BEGIN
+};
+
+
+ShotTimeline::ShotTimeline(size_t n_slots_)
+  : slots(NULL),
+    n_slots(n_slots_),
+    next_shot(0)
+{
+  slots = new Slot[n_slots];
+  Reset();
+}
+
+ShotTimeline::~ShotTimeline(){
+  if(slots){
+    delete[] slots;
+    slots = NULL;
+  }
+}
+
+// Forget all shots. Must not race with Begin().
+void ShotTimeline::Reset(){
+  for(size_t i=0; i<n_slots; ++i){
+    atomic_set(&slots[i].shot,-1);
+  }
+  atomic_set(&next_shot,0);
+}
+
+long ShotTimeline::Begin(){
+  double now = monotonic_ms();
+  long shot = atomic_get(&next_shot);
+  Slot& s = slots[shot % n_slots];
+  atomic_set(&s.shot,-1);
+  for(size_t i=0; i<SHOT_STAGES; ++i){
+    s.t[i] = -1.0;
+  }
+  s.t[SHOT_ARM] = now;
+  atomic_set(&s.shot,shot);
+  atomic_set(&next_shot,shot+1);
+  return shot;
+}
+
+// Stamps for shots that already got recycled are ignored.
+void ShotTimeline::Stamp(long shot, ShotStage stage){
+  if(shot < 0){
+    return;
+  }
+  double now = monotonic_ms();
+  Slot& s = slots[shot % n_slots];
+  if(atomic_get(&s.shot) == shot){
+    s.t[stage] = now;
+  }
+}
+
+// Copy the record of SHOT. Fails if the slot does not hold SHOT or
+// got recycled while copying.
+bool ShotTimeline::copy_record(long shot, ShotRecord& r) const {
+  Slot& s = slots[shot % n_slots];
+  if(atomic_get(&s.shot) != shot){
+    return false;
+  }
+  for(size_t i=0; i<SHOT_STAGES; ++i){
+    r.t[i] = s.t[i];
+  }
+  r.shot = shot;
+  return atomic_get(&s.shot) == shot;
+}
+
+void ShotTimeline::GetRecords(std::vector<ShotRecord>& records, size_t max_shots) const {
+  records.clear();
+  long last = atomic_get(const_cast<atomic_long_t*>(&next_shot)) - 1;
+  long n = (long)std::min(max_shots,n_slots-1);
+  ShotRecord r;
+  for(long shot=std::max(0L,last-n); shot<last; ++shot){
+    if(copy_record(shot,r)){
+      records.push_back(r);
+    }
+  }
+}
+
+static void fill_statistics(std::vector<double>& v, StageStatistics& s){
+  s.n = v.size();
+  if(s.n == 0){
+    return;
+  }
+  std::sort(v.begin(),v.end());
+  s.p50 = v[(size_t)(0.50*(s.n-1) + 0.5)];
+  s.p99 = v[(size_t)(0.99*(s.n-1) + 0.5)];
+  s.max = v.back();
+}
+
+void ShotTimeline::GetStatistics(std::vector<StageStatistics>& stats, size_t window) const {
+  std::vector<ShotRecord> records;
+  GetRecords(records,window);
+
+  std::vector< std::vector<double> > samples(SHOT_STAGES+2);
+  for(size_t k=0; k<records.size(); ++k){
+    const ShotRecord& r = records[k];
+    double last = r.t[SHOT_ARM];
+    for(size_t i=SHOT_ARM+1; i<SHOT_STAGES; ++i){
+      if(r.t[i] < 0){
+        continue;
+      }
+      size_t prev = stage_parent[i];
+      while(prev != SHOT_ARM && r.t[prev] < 0){
+        prev = stage_parent[prev];
+      }
+      samples[i].push_back(r.t[i] - r.t[prev]);
+      last = std::max(last,r.t[i]);
+    }
+    samples[SHOT_STAGES].push_back(last - r.t[SHOT_ARM]);
+    if(k > 0 && records[k-1].shot == r.shot-1){
+      samples[SHOT_STAGES+1].push_back(r.t[SHOT_ARM] - records[k-1].t[SHOT_ARM]);
+    }
+  }
+
+  stats.assign(SHOT_STAGES+2,StageStatistics());
+  for(size_t i=0; i<SHOT_STAGES+2; ++i){
+    fill_statistics(samples[i],stats[i]);
+  }
+}
+
+// One line of p50/p99/max in ms for every stage with samples.
+std::string ShotTimeline::FormatStatistics(size_t window) const {
+  std::vector<StageStatistics> stats;
+  GetStatistics(stats,window);
+  std::ostringstream os;
+  os.setf(std::ios::fixed);
+  os.precision(1);
+  for(size_t i=SHOT_ARM+1; i<SHOT_STAGES+2; ++i){
+    const StageStatistics& s = stats[i];
+    if(s.n == 0){
+      continue;
+    }
+    if(os.tellp() > 0){
+      os << "  ";
+    }
+    os << stage_labels[i] << " " << s.p50 << "/" << s.p99 << "/" << s.max;
+  }
+  return os.str();
+}
+
+// Dump every recorded shot, one line per shot with the time stamps of
+// all stages in ms relative to the arm time of the first shot. Skipped
+// stages are left empty.
+bool ShotTimeline::WriteCSV(const std::string& path) const {
+  std::vector<ShotRecord> records;
+  GetRecords(records,n_slots);
+
+  std::ofstream out(path.c_str());
+  if(!out){
+    return false;
+  }
+  out << "shot";
+  for(size_t i=0; i<SHOT_STAGES; ++i){
+    out << "," << stage_names[i];
+  }
+  out << "\n";
+
+  out.setf(std::ios::fixed);
+  out.precision(3);
+  double t0 = records.size() ? records[0].t[SHOT_ARM] : 0;
+  for(size_t k=0; k<records.size(); ++k){
+    const ShotRecord& r = records[k];
+    out << r.shot;
+    for(size_t i=0; i<SHOT_STAGES; ++i){
+      out << ",";
+      if(r.t[i] >= 0){
+        out << r.t[i] - t0;
+      }
+    }
+    out << "\n";
+  }
+  return out.good();
+}
+
+const char* ShotTimeline::GetStageName(size_t stage){
+  return stage < SHOT_STAGES+2 ? stage_names[stage] : "";
+}
+
+
+// shot_timeline.cc ends here
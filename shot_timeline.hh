@@ -0,0 +1,114 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 15:12:40 sb"
+
+/*
+  file       shot_timeline.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef SHOT_TIMELINE_HH
+#define SHOT_TIMELINE_HH
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "atomic_ops.hh"
+
+// Number of shots kept for CSV dumps
+#define SHOT_TIMELINE_RECORDS 4096
+
+// Number of recent shots the rolling statistics cover
+#define SHOT_TIMELINE_WINDOW 200
+
+// Stages of a shot. The camera thread stamps everything up to
+// SHOT_POSTED, the GUI thread stamps SHOT_DISPLAYED and the image
+// writer the save stages, which run concurrently with the display.
+enum ShotStage {
+  SHOT_ARM = 0,           // camera armed, or waiting for the next image when streaming
+  SHOT_ACQUIRED,          // driver reports the image (trigger seen, camera idle)
+  SHOT_DOWNLOAD_BEGIN,
+  SHOT_DOWNLOAD_END,
+  SHOT_POSTED,            // frame handed to the GUI, see CameraWorker::signal_image_ready()
+  SHOT_DISPLAYED,         // processed frame shown in the image window, skipped frames never get here
+  SHOT_SAVE_BEGIN,        // image writer picked up the frame
+  SHOT_SAVE_END,
+  SHOT_STAGES
+};
+
+// Time stamps of one shot in ms from monotonic_ms(), negative for
+// stages the shot skipped.
+class ShotRecord {
+  public:
+    long shot;
+    double t[SHOT_STAGES];
+};
+
+// Rolling statistics of one stage in ms
+class StageStatistics {
+  public:
+    size_t n;
+    double p50;
+    double p99;
+    double max;
+    StageStatistics() : n(0), p50(0), p99(0), max(0) {}
+};
+
+/*
+  Per-shot time stamps of every acquisition stage. The camera thread
+  opens a record for each shot with Begin() and any thread may add
+  time stamps with Stamp(). Records live in a
+  preallocated ring indexed by shot number, so stamping never locks
+  or allocates. Readers copy records and discard those that got
+  recycled while copying.
+
+  The duration of a stage is the time since the stage it follows in
+  the pipeline, or since the closest earlier one the shot went
+  through, so skipped stages (no saving, frame dropped for display)
+  do not show up as zero.
+ */
+class ShotTimeline {
+  private:
+    struct Slot {
+      atomic_long_t shot; // shot held by this slot, -1 while recycling
+      volatile double t[SHOT_STAGES];
+    };
+
+    Slot* slots;
+    size_t n_slots;
+    atomic_long_t next_shot; // number of the next shot to begin
+
+    ShotTimeline(const ShotTimeline&){}
+    bool copy_record(long shot, ShotRecord& r) const;
+
+  public:
+    ShotTimeline(size_t n_slots_=SHOT_TIMELINE_RECORDS);
+    ~ShotTimeline();
+
+    // Start a new shot, stamp SHOT_ARM and return its number.
+    long Begin();
+    void Stamp(long shot, ShotStage stage);
+    void Reset();
+
+    // Copy up to MAX_SHOTS of the most recent finished shots, oldest
+    // first. The shot begun last is still in progress and left out.
+    void GetRecords(std::vector<ShotRecord>& records, size_t max_shots) const;
+
+    // Statistics over the last WINDOW shots for every stage, plus the
+    // total time from SHOT_ARM to the latest stage of each shot (index
+    // SHOT_STAGES) and the cycle time between consecutive arms (index
+    // SHOT_STAGES+1).
+    void GetStatistics(std::vector<StageStatistics>& stats,
+                       size_t window=SHOT_TIMELINE_WINDOW) const;
+    std::string FormatStatistics(size_t window=SHOT_TIMELINE_WINDOW) const;
+    bool WriteCSV(const std::string& path) const;
+
+    static const char* GetStageName(size_t stage);
+};
+
+
+#endif // SHOT_TIMELINE_HH
+
+// shot_timeline.hh ends here
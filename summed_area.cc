@@ -0,0 +1,159 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-18 01:52:07 sb"
+
+/*
+  file       summed_area.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "summed_area.hh"
+
+#include <algorithm>
+
+/*
+  The table is built in two passes over bands of rows, see BandPool.
+  The first pass sums each band on its own, as if the rows above it
+  were empty. The second pass adds the sums of all bands above, which
+  are the last rows of those bands, to the rows of each band. The
+  first band continues from the table row above it, which is zero
+  for a full build.
+ */
+
+// Fill the table rows below image rows FIRST + [ROW0, ROW1) of band
+// BAND.
+template <typename T>
+class SummedAreaRowTask : public BandTask {
+  private:
+    SummedAreaTable* sat;
+    const T* data;
+    size_t first;
+  public:
+    SummedAreaRowTask(SummedAreaTable* sat_, const T* data_, size_t first_)
+      : sat(sat_), data(data_), first(first_) {}
+    void Run(size_t band, size_t row0, size_t row1){
+      const size_t M = SUMMED_AREA_MOMENTS;
+      size_t w = sat->GetWidth();
+      for(size_t j=first+row0; j<first+row1; ++j){
+        const T* row = data + j*w;
+        double y = (double)j;
+        double* d = sat->GetEntry(0,j+1);
+        const double* a = band == 0 || j > first+row0 ? sat->GetEntry(0,j) : NULL;
+        std::fill(d,d+M,0.0);
+        double s = 0, sx = 0, sxx = 0; // row sums so far
+        for(size_t i=0; i<w; ++i){
+          double t = (double)row[i], x = (double)i;
+          s += t;
+          sx += t*x;
+          sxx += t*x*x;
+          d += M;
+          if(a){
+            a += M;
+            d[0] = a[0] + s;     d[1] = a[1] + sx;    d[2] = a[2] + y*s;
+            d[3] = a[3] + sxx;   d[4] = a[4] + y*y*s; d[5] = a[5] + y*sx;
+          }
+          else{
+            d[0] = s;   d[1] = sx;    d[2] = y*s;
+            d[3] = sxx; d[4] = y*y*s; d[5] = y*sx;
+          }
+        }
+      }
+    }
+};
+
+// Add the sums of the bands above to the rows of each band.
+class SummedAreaOffsetTask : public BandTask {
+  private:
+    SummedAreaTable* sat;
+    const std::vector<double>& offsets; // one table row per band
+    size_t first;
+  public:
+    SummedAreaOffsetTask(SummedAreaTable* sat_, const std::vector<double>& offsets_,
+                         size_t first_)
+      : sat(sat_), offsets(offsets_), first(first_) {}
+    void Run(size_t band, size_t row0, size_t row1){
+      if(band == 0){
+        return;
+      }
+      size_t n = SUMMED_AREA_MOMENTS*(sat->GetWidth()+1);
+      const double* o = &offsets[band*n];
+      for(size_t j=first+row0; j<first+row1; ++j){
+        double* d = sat->GetEntry(0,j+1);
+        for(size_t k=0; k<n; ++k){
+          d[k] += o[k];
+        }
+      }
+    }
+};
+
+// Fill the table rows below image rows [ROW0, height), keeping the
+// rows above.
+template <typename T>
+void SummedAreaTable::build(const T* data, size_t row0, BandPool& pool){
+  if(row0 >= height){
+    return;
+  }
+  size_t rows = height - row0;
+  SummedAreaRowTask<T> sums(this,data,row0);
+  pool.Run(sums,rows);
+
+  size_t n_bands = pool.GetBandCount(rows);
+  if(n_bands < 2){
+    return;
+  }
+  size_t n = SUMMED_AREA_MOMENTS*(width+1);
+  std::vector<double> offsets(n_bands*n,0.0);
+  for(size_t b=1; b<n_bands; ++b){
+    const double* last = GetEntry(0,row0+BandPool::GetBandRow(b,rows,n_bands));
+    for(size_t k=0; k<n; ++k){
+      offsets[b*n+k] = offsets[(b-1)*n+k] + last[k];
+    }
+  }
+  SummedAreaOffsetTask fix(this,offsets,row0);
+  pool.Run(fix,rows);
+}
+
+void SummedAreaTable::Build(const float* data, size_t width_, size_t height_, BandPool& pool){
+  width = width_;
+  height = height_;
+  table.resize(SUMMED_AREA_MOMENTS*(width+1)*(height+1));
+  std::fill(table.begin(),table.begin()+SUMMED_AREA_MOMENTS*(width+1),0.0);
+  build(data,0,pool);
+}
+
+void SummedAreaTable::Build(const pixel_t* data, size_t width_, size_t height_, BandPool& pool){
+  width = width_;
+  height = height_;
+  table.resize(SUMMED_AREA_MOMENTS*(width+1)*(height+1));
+  std::fill(table.begin(),table.begin()+SUMMED_AREA_MOMENTS*(width+1),0.0);
+  build(data,0,pool);
+}
+
+void SummedAreaTable::Update(const float* data, size_t row0, BandPool& pool){
+  build(data,row0,pool);
+}
+
+void SummedAreaTable::AddMoments(size_t x, size_t y, size_t w, size_t h, RoiMoments& m) const {
+  if(w == 0 || h == 0 || x+w > width || y+h > height){
+    return;
+  }
+  const double* a = GetEntry(x,y);
+  const double* b = GetEntry(x+w,y);
+  const double* c = GetEntry(x,y+h);
+  const double* d = GetEntry(x+w,y+h);
+  double v[SUMMED_AREA_MOMENTS];
+  for(size_t k=0; k<SUMMED_AREA_MOMENTS; ++k){
+    v[k] = (d[k] - b[k]) - (c[k] - a[k]);
+  }
+  // Move the origin to (x, y)
+  double x0 = (double)x, y0 = (double)y;
+  m.n += w*h;
+  m.s.Add(v[0]);
+  m.sx.Add(v[1] - x0*v[0]);
+  m.sy.Add(v[2] - y0*v[0]);
+  m.sxx.Add(v[3] - 2*x0*v[1] + x0*x0*v[0]);
+  m.syy.Add(v[4] - 2*y0*v[2] + y0*y0*v[0]);
+  m.sxy.Add(v[5] - x0*v[2] - y0*v[1] + x0*y0*v[0]);
+}
+
+// summed_area.cc ends here
@@ -0,0 +1,79 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-18 01:38:20 sb"
+
+/*
+  file       summed_area.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef SUMMED_AREA_HH
+#define SUMMED_AREA_HH
+
+#include <cstddef>
+#include <vector>
+
+#include "band_pool.hh"
+#include "frame_ring.hh"
+#include "roi_moments.hh"
+
+// Sums per table entry: t, t x, t y, t x^2, t y^2, t x y
+#define SUMMED_AREA_MOMENTS 6
+
+/*
+  Summed-area table of the pixel values t of an image and of their
+  first and second moments in the pixel coordinates (x, y). Entry
+  (i, j) holds the sums over all pixels left of column i and above
+  row j, so the sums over any rectangle follow from its four corners.
+  After building the table once per image, the moments of any number
+  of rectangles cost a few additions each.
+
+  The table takes 6 doubles per pixel. Rectangle sums are differences
+  of table entries, which for a 1 Mpx image of 16 bit counts still
+  leaves the moments of small rectangles far from the origin good to
+  about 6 digits. A NaN pixel spoils every rectangle whose far corner
+  lies below and right of it.
+ */
+class SummedAreaTable {
+  private:
+    size_t width, height;
+    std::vector<double> table; // (width+1) x (height+1) entries
+
+    template <typename T>
+    void build(const T* data, size_t row0, BandPool& pool);
+
+  public:
+    SummedAreaTable() : width(0), height(0) {}
+
+    // Build the table of the WIDTH_ x HEIGHT_ image DATA, splitting
+    // the rows over POOL.
+    void Build(const float* data, size_t width_, size_t height_, BandPool& pool);
+    void Build(const pixel_t* data, size_t width_, size_t height_, BandPool& pool);
+    // Rebuild the table below image row ROW0 after the rows from ROW0
+    // on of the image changed to DATA. Costs the share of the rows
+    // rebuilt of a Build().
+    void Update(const float* data, size_t row0, BandPool& pool);
+
+    size_t GetWidth() const {return width;}
+    size_t GetHeight() const {return height;}
+
+    // Entry (I, J), SUMMED_AREA_MOMENTS sums
+    double* GetEntry(size_t i, size_t j){
+      return &table[SUMMED_AREA_MOMENTS*(j*(width+1)+i)];
+    }
+    const double* GetEntry(size_t i, size_t j) const {
+      return &table[SUMMED_AREA_MOMENTS*(j*(width+1)+i)];
+    }
+
+    // Add the sums over the W x H pixels at (X, Y) to M, with
+    // coordinates relative to (X, Y) as for a ROI. The rectangle has
+    // to lie within the image. The minimum and maximum of M stay as
+    // they are.
+    void AddMoments(size_t x, size_t y, size_t w, size_t h, RoiMoments& m) const;
+};
+
+
+#endif // SUMMED_AREA_HH
+
+// summed_area.hh ends here
@@ -0,0 +1,141 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 19:22:40 sb"
+
+/*
+  file       telemetry.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "telemetry.hh"
+#include "camera.hh"
+#include "andor_driver.hh"
+
+#include <algorithm>
+#include <sstream>
+
+
+std::string format_telemetry(const TelemetrySample& s){
+  std::ostringstream os;
+  os.setf(std::ios::fixed);
+  os.precision(1);
+  os << s.temperature << " C";
+  switch(s.temperature_status){
+  case DRV_TEMP_STABILIZED: os << " stabilized"; break;
+  case DRV_TEMP_NOT_REACHED: os << " not reached"; break;
+  case DRV_TEMP_NOT_STABILIZED: os << " not stabilized"; break;
+  case DRV_TEMP_DRIFT: os << " drifting"; break;
+  default: break;
+  }
+  if(s.cooler >= 0){
+    os << ", cooler " << (s.cooler ? "on" : "off");
+  }
+  switch(s.status){
+  case DRV_IDLE: os << ", idle"; break;
+  case DRV_ACQUIRING: os << ", acquiring"; break;
+  case DRV_TEMPCYCLE: os << ", temperature cycle"; break;
+  case -1: break;
+  default: os << ", status " << s.status; break;
+  }
+  return os.str();
+}
+
+
+TelemetryRing::TelemetryRing(size_t n_slots_)
+  : slots(NULL),
+    n_slots(n_slots_),
+    next(0)
+{
+  slots = new Slot[n_slots];
+  for(size_t i=0; i<n_slots; ++i){
+    atomic_set(&slots[i].n,-1);
+  }
+}
+
+TelemetryRing::~TelemetryRing(){
+  if(slots){
+    delete[] slots;
+    slots = NULL;
+  }
+}
+
+void TelemetryRing::Push(const TelemetrySample& s){
+  long n = atomic_get(&next);
+  Slot& x = slots[n % n_slots];
+  atomic_set(&x.n,-1);
+  x.t = s.t;
+  x.temperature = s.temperature;
+  x.temperature_status = s.temperature_status;
+  x.cooler = s.cooler;
+  x.status = s.status;
+  atomic_set(&x.n,n);
+  atomic_set(&next,n+1);
+}
+
+// Copy sample N. Fails if the slot does not hold N or got recycled
+// while copying.
+bool TelemetryRing::copy_sample(long n, TelemetrySample& s) const {
+  Slot& x = slots[n % n_slots];
+  if(atomic_get(&x.n) != n){
+    return false;
+  }
+  s.t = x.t;
+  s.temperature = x.temperature;
+  s.temperature_status = x.temperature_status;
+  s.cooler = x.cooler;
+  s.status = x.status;
+  return atomic_get(&x.n) == n;
+}
+
+bool TelemetryRing::GetLatest(TelemetrySample& s) const {
+  long n = atomic_get(const_cast<atomic_long_t*>(&next)) - 1;
+  return n >= 0 && copy_sample(n,s);
+}
+
+void TelemetryRing::GetHistory(std::vector<TelemetrySample>& samples,
+                               size_t max_samples) const
+{
+  samples.clear();
+  long last = atomic_get(const_cast<atomic_long_t*>(&next));
+  // leave one slot of slack for the sample being written
+  long n = (long)std::min(max_samples,n_slots-1);
+  TelemetrySample s;
+  for(long k=std::max(0L,last-n); k<last; ++k){
+    if(copy_sample(k,s)){
+      samples.push_back(s);
+    }
+  }
+}
+
+
+TelemetryWorker::TelemetryWorker(Camera* camera_, TelemetryRing* ring_,
+                                 long period_ms_)
+  : wxThread(wxTHREAD_JOINABLE),
+    camera(camera_),
+    ring(ring_),
+    period_ms(period_ms_),
+    condition(mutex),
+    quit(false)
+{
+}
+
+void* TelemetryWorker::Entry(){
+  wxMutexLocker lock(mutex);
+  while(!quit){
+    TelemetrySample s;
+    if(camera->ReadTelemetry(s)){
+      ring->Push(s);
+    }
+    condition.WaitTimeout(period_ms);
+  }
+  return NULL;
+}
+
+void TelemetryWorker::Quit(){
+  wxMutexLocker lock(mutex);
+  quit = true;
+  condition.Broadcast();
+}
+
+
+// telemetry.cc ends here
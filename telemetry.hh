@@ -0,0 +1,113 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 19:05:12 sb"
+
+/*
+  file       telemetry.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef TELEMETRY_HH
+#define TELEMETRY_HH
+
+#include <wx/thread.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "atomic_ops.hh"
+
+// Time between two telemetry samples in ms
+#define TELEMETRY_PERIOD_MS 1000
+
+// Number of samples kept per camera, one hour at the default period
+#define TELEMETRY_RECORDS 3600
+
+// Camera state at one point in time
+class TelemetrySample {
+  public:
+    double t; // monotonic_ms() when sampled
+    float temperature; // CCD temperature in C
+    unsigned int temperature_status; // DRV_TEMP_* code, 0 if unknown
+    int cooler; // 1 if the cooler is on, 0 if off, -1 if unknown
+    int status; // DRV_IDLE, DRV_ACQUIRING, ..., -1 if unknown
+
+    TelemetrySample()
+      : t(0), temperature(0), temperature_status(0), cooler(-1), status(-1)
+    {}
+};
+
+// Short description of S for the status bar, like
+// "-70.0 C stabilized, cooler on, idle".
+std::string format_telemetry(const TelemetrySample& s);
+
+/*
+  Time series of telemetry samples. One thread appends with Push(),
+  any thread reads. Samples live in a preallocated ring, so pushing
+  never locks or allocates and readers never hold up the sampler.
+  Readers copy samples and discard those that got recycled while
+  copying, like ShotTimeline does.
+ */
+class TelemetryRing {
+  private:
+    struct Slot {
+      atomic_long_t n; // number of the sample held, -1 while writing
+      volatile double t;
+      volatile float temperature;
+      volatile unsigned int temperature_status;
+      volatile int cooler;
+      volatile int status;
+    };
+
+    Slot* slots;
+    size_t n_slots;
+    atomic_long_t next; // number of the next sample
+
+    TelemetryRing(const TelemetryRing&){}
+    bool copy_sample(long n, TelemetrySample& s) const;
+
+  public:
+    TelemetryRing(size_t n_slots_=TELEMETRY_RECORDS);
+    ~TelemetryRing();
+
+    void Push(const TelemetrySample& s);
+    // Most recent sample, false if there is none yet.
+    bool GetLatest(TelemetrySample& s) const;
+    // Copy up to MAX_SAMPLES of the most recent samples, oldest first.
+    void GetHistory(std::vector<TelemetrySample>& samples,
+                    size_t max_samples=TELEMETRY_RECORDS) const;
+};
+
+/*
+  Low priority thread that samples the temperature, cooler and
+  acquisition status of one camera every PERIOD_MS into a
+  TelemetryRing. The driver calls it makes are short and allowed while
+  the camera acquires, so the sampler runs next to the acquisition
+  loop instead of going through its command channel.
+ */
+class Camera;
+class TelemetryWorker : public wxThread {
+  private:
+    Camera* camera;
+    TelemetryRing* ring;
+    long period_ms;
+    wxMutex mutex; // protects quit
+    wxCondition condition; // signaled by Quit()
+    bool quit;
+
+    TelemetryWorker(const TelemetryWorker&) : condition(mutex) {}
+
+  public:
+    TelemetryWorker(Camera* camera_, TelemetryRing* ring_,
+                    long period_ms_=TELEMETRY_PERIOD_MS);
+
+    virtual void* Entry();
+    // Stop sampling. Wait() for the thread afterwards.
+    void Quit();
+};
+
+
+#endif // TELEMETRY_HH
+
+// telemetry.hh ends here
@@ -0,0 +1,141 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 20:11:05 sb"
+
+/*
+  file       telemetry_plot.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "telemetry_plot.hh"
+#include "andor_driver.hh"
+#include "monotonic_clock.hh"
+
+#include <wx/dcbuffer.h>
+#include <algorithm>
+#include <cmath>
+
+// Line colors of the cameras
+static const unsigned char series_colors[][3] = {
+  {0,255,0}, {255,64,64}, {64,160,255}, {255,255,0}
+};
+static const size_t n_series_colors = 4;
+
+
+BEGIN_EVENT_TABLE(TelemetryPlot,wxPanel)
+EVT_PAINT(TelemetryPlot::OnPaint)
+EVT_ERASE_BACKGROUND(TelemetryPlot::OnEraseBackground)
+END_EVENT_TABLE()
+
+TelemetryPlot::TelemetryPlot(wxWindow* parent, wxWindowID id)
+  : wxPanel(parent,id)
+{
+  SetBackgroundColour(*wxBLACK);
+}
+
+void TelemetryPlot::AddSeries(const TelemetryRing* ring, const wxString& label){
+  rings.push_back(ring);
+  labels.push_back(label);
+}
+
+void TelemetryPlot::OnPaint(wxPaintEvent&){
+  wxBufferedPaintDC dc(this);
+  wxCoord w,h;
+  dc.GetSize(&w,&h);
+  dc.SetPen(*wxBLACK_PEN);
+  dc.SetBrush(*wxBLACK_BRUSH);
+  dc.DrawRectangle(0,0,w,h);
+
+  wxFont fnt = wxFont(8,wxFONTFAMILY_DEFAULT,wxFONTSTYLE_NORMAL,
+                      wxFONTWEIGHT_NORMAL,false,wxT(""),
+                      wxFONTENCODING_DEFAULT);
+  dc.SetFont(fnt);
+  dc.SetTextBackground(*wxBLACK);
+  dc.SetTextForeground(*wxWHITE);
+
+  int pad = TELEMETRY_PLOT_PAD;
+  wxRect area(pad,pad,w-2*pad,h-3*pad);
+  if(area.width <= 0 || area.height <= 0){
+    return;
+  }
+
+  // Common time and temperature range of all cameras
+  std::vector< std::vector<TelemetrySample> > history(rings.size());
+  double t1 = monotonic_ms();
+  double t0 = t1;
+  double y0 = 1e30, y1 = -1e30;
+  for(size_t k=0; k<rings.size(); ++k){
+    rings[k]->GetHistory(history[k]);
+    for(size_t i=0; i<history[k].size(); ++i){
+      const TelemetrySample& s = history[k][i];
+      t0 = std::min(t0,s.t);
+      if(s.temperature_status){
+        y0 = std::min(y0,(double)s.temperature);
+        y1 = std::max(y1,(double)s.temperature);
+      }
+    }
+  }
+  if(y0 > y1){
+    y0 = y1 = 0;
+  }
+  if(y1 - y0 < TELEMETRY_PLOT_MIN_RANGE){
+    double c = 0.5*(y0+y1);
+    y0 = c - 0.5*TELEMETRY_PLOT_MIN_RANGE;
+    y1 = c + 0.5*TELEMETRY_PLOT_MIN_RANGE;
+  }
+  if(t1 - t0 < 1e3){
+    t0 = t1 - 1e3;
+  }
+
+  // Frame and axis labels
+  dc.SetPen(*wxWHITE_PEN);
+  dc.SetBrush(*wxTRANSPARENT_BRUSH);
+  dc.DrawRectangle(area.x,area.y,area.width,area.height);
+  dc.DrawText(wxString::Format("%.1f C",y1),2,area.y);
+  dc.DrawText(wxString::Format("%.1f C",y0),2,area.y+area.height-10);
+  dc.DrawText(wxString::Format("-%.0f s",(t1-t0)*1e-3),area.x,area.y+area.height+2);
+  dc.DrawText("now",area.x+area.width-20,area.y+area.height+2);
+
+  for(size_t k=0; k<rings.size(); ++k){
+    draw_series(dc,area,k,history[k],t0,t1,y0,y1);
+  }
+}
+
+// Draw the temperatures of camera K into AREA, its acquisition bar
+// below and its latest state as legend above.
+void TelemetryPlot::draw_series(wxDC& dc, const wxRect& area, size_t k,
+                                const std::vector<TelemetrySample>& s,
+                                double t0, double t1, double y0, double y1)
+{
+  const unsigned char* c = series_colors[k % n_series_colors];
+  wxColour colour(c[0],c[1],c[2]);
+  dc.SetPen(wxPen(colour));
+  dc.SetTextForeground(colour);
+
+  wxString legend = labels[k] + ": ";
+  legend += s.size() ? format_telemetry(s.back()).c_str() : "no data";
+  dc.DrawText(legend,area.x,2 + 12*(int)k);
+
+  double sx = area.width / (t1 - t0);
+  double sy = area.height / (y1 - y0);
+  int bar_y = area.y + area.height + 16 + 6*(int)k;
+  std::vector<wxPoint> line;
+  for(size_t i=0; i<s.size(); ++i){
+    int x = area.x + (int)floor((s[i].t - t0)*sx + 0.5);
+    if(s[i].status == DRV_ACQUIRING){
+      int x1 = i+1 < s.size() ? area.x + (int)floor((s[i+1].t - t0)*sx + 0.5) : x+1;
+      dc.DrawLine(x,bar_y,x1,bar_y);
+    }
+    if(!s[i].temperature_status){
+      continue;
+    }
+    int y = area.y + area.height - (int)floor((s[i].temperature - y0)*sy + 0.5);
+    line.push_back(wxPoint(x,y));
+  }
+  if(line.size() > 1){
+    dc.DrawLines((int)line.size(),&line[0]);
+  }
+}
+
+
+// telemetry_plot.cc ends here
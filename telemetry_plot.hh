@@ -0,0 +1,54 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 19:48:31 sb"
+
+/*
+  file       telemetry_plot.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef TELEMETRY_PLOT_HH
+#define TELEMETRY_PLOT_HH
+
+#include <wx/wx.h>
+#include <vector>
+
+#include "telemetry.hh"
+
+// Padding around the plot area in px
+#define TELEMETRY_PLOT_PAD 40
+
+// Smallest temperature range shown in C
+#define TELEMETRY_PLOT_MIN_RANGE 2.0
+
+/*
+  Plot of the CCD temperature history of every camera, read from
+  their TelemetryRing. A bar under the plot marks when the camera was
+  acquiring. Call Refresh() to redraw with the latest samples.
+ */
+class TelemetryPlot : public wxPanel {
+  private:
+    std::vector<const TelemetryRing*> rings;
+    std::vector<wxString> labels;
+
+    void draw_series(wxDC& dc, const wxRect& area, size_t k,
+                     const std::vector<TelemetrySample>& s,
+                     double t0, double t1, double y0, double y1);
+
+  public:
+    TelemetryPlot(wxWindow* parent, wxWindowID id);
+
+    void AddSeries(const TelemetryRing* ring, const wxString& label);
+
+    void OnPaint(wxPaintEvent&);
+    // Empty, OnPaint draws the whole control.
+    void OnEraseBackground(wxEraseEvent&){}
+
+    DECLARE_EVENT_TABLE()
+};
+
+
+#endif // TELEMETRY_PLOT_HH
+
+// telemetry_plot.hh ends here
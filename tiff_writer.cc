@@ -0,0 +1,112 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 13:21:48 sb"
+
+/*
+  file       tiff_writer.cc
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+#include "tiff_writer.hh"
+
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+
+// Append little endian integers to a byte buffer
+static void put16(std::vector<unsigned char>& b, unsigned int v){
+  b.push_back((unsigned char)(v & 0xff));
+  b.push_back((unsigned char)((v >> 8) & 0xff));
+}
+
+static void put32(std::vector<unsigned char>& b, unsigned long v){
+  put16(b,(unsigned int)(v & 0xffff));
+  put16(b,(unsigned int)((v >> 16) & 0xffff));
+}
+
+// One 12 byte IFD entry with a single value
+static void put_entry(std::vector<unsigned char>& b, unsigned int tag,
+                      unsigned int type, unsigned long value)
+{
+  put16(b,tag);
+  put16(b,type);
+  put32(b,1);
+  if(type == 3){ // SHORT, left justified in the value field
+    put16(b,(unsigned int)value);
+    put16(b,0);
+  }
+  else{
+    put32(b,value);
+  }
+}
+
+bool write_tiff16(const std::string& path, const pixel_t* data,
+                  unsigned int width, unsigned int height)
+{
+  const unsigned int n_entries = 12;
+  const unsigned long ifd_offset = 8;
+  const unsigned long ifd_size = 2 + 12*n_entries + 4;
+  const unsigned long res_offset = ifd_offset + ifd_size; // two RATIONALs
+  const unsigned long data_offset = res_offset + 16;
+  const unsigned long data_size = 2ul*width*height;
+
+  std::vector<unsigned char> hdr;
+  hdr.reserve(data_offset);
+  hdr.push_back('I'); hdr.push_back('I');
+  put16(hdr,42);
+  put32(hdr,ifd_offset);
+
+  put16(hdr,n_entries);
+  put_entry(hdr,256,4,width);        // ImageWidth
+  put_entry(hdr,257,4,height);       // ImageLength
+  put_entry(hdr,258,3,16);           // BitsPerSample
+  put_entry(hdr,259,3,1);            // Compression: none
+  put_entry(hdr,262,3,1);            // PhotometricInterpretation: BlackIsZero
+  put_entry(hdr,273,4,data_offset);  // StripOffsets
+  put_entry(hdr,277,3,1);            // SamplesPerPixel
+  put_entry(hdr,278,4,height);       // RowsPerStrip
+  put_entry(hdr,279,4,data_size);    // StripByteCounts
+  put16(hdr,282); put16(hdr,5); put32(hdr,1); put32(hdr,res_offset);   // XResolution
+  put16(hdr,283); put16(hdr,5); put32(hdr,1); put32(hdr,res_offset+8); // YResolution
+  put_entry(hdr,296,3,2);            // ResolutionUnit: inch
+  put32(hdr,0);                      // no further IFD
+  put32(hdr,72); put32(hdr,1);
+  put32(hdr,72); put32(hdr,1);
+
+  FILE* f = fopen(path.c_str(),"wb");
+  if(!f){
+    return false;
+  }
+  bool ok = fwrite(&hdr[0],1,hdr.size(),f) == hdr.size();
+
+  // Convert row by row to little endian byte order
+  std::vector<unsigned char> row(2*width);
+  for(unsigned int j=0; ok && j<height; ++j){
+    const pixel_t* p = data + (size_t)j*width;
+    for(unsigned int i=0; i<width; ++i){
+      row[2*i]   = (unsigned char)(p[i] & 0xff);
+      row[2*i+1] = (unsigned char)((p[i] >> 8) & 0xff);
+    }
+    ok = fwrite(&row[0],1,row.size(),f) == row.size();
+  }
+  if(fclose(f) != 0){
+    ok = false;
+  }
+  return ok;
+}
+
+bool write_frame_tiff(const std::string& path, const Frame& frame){
+  unsigned int h = frame.height / frame.n_images;
+  for(unsigned int i=0; i<frame.n_images; ++i){
+    std::ostringstream os;
+    os << path << "_" << i;
+    if(!write_tiff16(os.str(),frame.data + (size_t)i*h*frame.width,frame.width,h)){
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// tiff_writer.cc ends here
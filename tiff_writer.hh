@@ -0,0 +1,32 @@
+// -*- mode: C++/lah -*-
+// Time-stamp: "2026-10-17 13:05:36 sb"
+
+/*
+  file       tiff_writer.hh
+  copyright  (c) Sebastian Blatt 2010, 2011, 2012
+
+ */
+
+
+#ifndef TIFF_WRITER_HH
+#define TIFF_WRITER_HH
+
+#include <string>
+
+#include "frame_ring.hh"
+
+// Write WIDTH x HEIGHT pixels from DATA as an uncompressed 16 bit
+// grayscale baseline TIFF to PATH. The file matches the output of
+// SaveAsTiffEx with type 1. Returns false if the file could not be
+// written.
+bool write_tiff16(const std::string& path, const pixel_t* data,
+                  unsigned int width, unsigned int height);
+
+// Write the sub images of FRAME to PATH_0, PATH_1, ..., one file
+// each.
+bool write_frame_tiff(const std::string& path, const Frame& frame);
+
+
+#endif // TIFF_WRITER_HH
+
+// tiff_writer.hh ends here